@@ -17,7 +17,8 @@ SOURCES += dialogbox.cc \
            dialog_main.cc \
            dialog_set_options.cc \
            dialog_slots.cc \
-           dialog_private.cc
+           dialog_private.cc \
+           dialog_list_model.cc
 
 # install recipe options
 target.path = /usr/bin
@@ -0,0 +1,342 @@
+/*
+ * GUI widgets for shell scripts - dialogbox version 1.0
+ *
+ * Copyright (C) 2015-2016, 2020 Andriy Martynets <andy.martynets@gmail.com>
+ *------------------------------------------------------------------------------
+ * This file is part of dialogbox.
+ *
+ * Dialogbox is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dialogbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dialogbox. If not, see http://www.gnu.org/licenses/.
+ *------------------------------------------------------------------------------
+ */
+
+#include "dialogbox.h"
+
+/*******************************************************************************
+ *  ListModel constructor
+ ******************************************************************************/
+ListModel::ListModel(QObject *parent):
+    QAbstractListModel(parent),
+    wastedTexts(0),
+    wastedIcons(0),
+    indexDirty(false)
+{
+}
+
+int ListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : items.count();
+}
+
+QVariant ListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= items.count())
+        return QVariant();
+
+    const Item &item = items.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return QString::fromUtf8(texts.constData() + item.offset, item.size);
+    case Qt::DecorationRole:
+        if (item.icon >= 0)
+            return icons.at(item.icon);
+        break;
+    }
+
+    return QVariant();
+}
+
+bool ListModel::setData(const QModelIndex &index, const QVariant &value,
+                        int role)
+{
+    if (!index.isValid() || index.row() >= items.count())
+        return false;
+
+    Item &item = items[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        unindexItem(index.row());
+        setText(item, value.toString());
+        indexItem(index.row());
+        break;
+    case Qt::DecorationRole:
+        setIcon(item, value.value<QIcon>());
+        break;
+    default:
+        return false;
+    }
+
+    compact();
+    emit dataChanged(index, index);
+
+    return true;
+}
+
+Qt::ItemFlags ListModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+bool ListModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || row < 0 || row > items.count() || count < 1)
+        return false;
+
+    const Item item = {0, 0, -1};
+
+    beginInsertRows(parent, row, row + count - 1);
+    items.insert(row, count, item);
+    endInsertRows();
+
+    indexDirty = true;
+
+    return true;
+}
+
+bool ListModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || row < 0 || count < 1
+        || row + count > items.count())
+        return false;
+
+    beginRemoveRows(parent, row, row + count - 1);
+    for (int i = row; i < row + count; i++) {
+        wastedTexts += items.at(i).size;
+        if (items.at(i).icon >= 0)
+            wastedIcons++;
+    }
+    if (row + count == items.count()) {
+        for (int i = row; i < row + count; i++)
+            unindexItem(i);
+    } else if (!indexDirty) {
+        // Rows below the removed ones move up, their texts stay the same
+        QMultiHash<uint, int>::iterator i = textsIndex.begin();
+
+        while (i != textsIndex.end()) {
+            if (i.value() < row) {
+                ++i;
+            } else if (i.value() < row + count) {
+                i = textsIndex.erase(i);
+            } else {
+                i.value() -= count;
+                ++i;
+            }
+        }
+    }
+    items.remove(row, count);
+    endRemoveRows();
+
+    compact();
+
+    return true;
+}
+
+/*******************************************************************************
+ *  insertItem inserts a single row with the given content. Unlike insertRows
+ *  and setData calls this emits no dataChanged signals.
+ ******************************************************************************/
+void ListModel::insertItem(int row, const QString &text, const QIcon &icon)
+{
+    if (row < 0 || row > items.count())
+        row = items.count();
+
+    Item item = {0, 0, -1};
+
+    setText(item, text);
+    setIcon(item, icon);
+
+    beginInsertRows(QModelIndex(), row, row);
+    items.insert(row, item);
+    endInsertRows();
+
+    if (row == items.count() - 1)
+        indexItem(row);
+    else
+        indexDirty = true;
+}
+
+/*******************************************************************************
+ *  insertItems inserts rows with texts given one per line (UTF-8 encoded) at
+ *  once. Returns the number of rows inserted.
+ ******************************************************************************/
+int ListModel::insertItems(int row, const QByteArray &lines)
+{
+    const char *data = lines.constData();
+    int size = lines.size();
+    QVector<Item> inserted;
+
+    if (row < 0 || row > items.count())
+        row = items.count();
+
+    texts.reserve(texts.size() + size);
+    for (int i = 0; i < size; ) {
+        const char *end = (const char *)memchr(data + i, '\n', size - i);
+        Item item = {texts.size(), end ? int(end - data) - i : size - i, -1};
+
+        texts.append(data + i, item.size);
+        inserted.append(item);
+        i += item.size + 1;
+    }
+
+    if (inserted.isEmpty())
+        return 0;
+
+    beginInsertRows(QModelIndex(), row, row + inserted.count() - 1);
+    items.insert(row, inserted.count(), inserted.first());
+    for (int i = 1, j = inserted.count(); i < j; i++)
+        items[row + i] = inserted.at(i);
+    endInsertRows();
+
+    if (row + inserted.count() == items.count()) {
+        for (int i = row, j = items.count(); i < j; i++)
+            indexItem(i);
+    } else {
+        indexDirty = true;
+    }
+
+    return inserted.count();
+}
+
+/*******************************************************************************
+ *  findItem returns the first row with the given text (UTF-8 encoded) or -1
+ *  if there is none.
+ ******************************************************************************/
+int ListModel::findItem(const char *text)
+{
+    int size = strlen(text);
+    uint key = qHash(QByteArray::fromRawData(text, size));
+    QMultiHash<uint, int>::const_iterator i;
+    int row = -1;
+
+    if (indexDirty) {
+        textsIndex.clear();
+        indexDirty = false;
+        for (int i = 0, j = items.count(); i < j; i++)
+            indexItem(i);
+    }
+
+    for (i = textsIndex.constFind(key);
+         i != textsIndex.constEnd() && i.key() == key; ++i) {
+        const Item &item = items.at(i.value());
+
+        if (item.size == size
+            && !memcmp(texts.constData() + item.offset, text, size)
+            && (row < 0 || i.value() < row))
+            row = i.value();
+    }
+
+    return row;
+}
+
+/*******************************************************************************
+ *  indexItem puts the row onto the index unless the index is to be rebuilt.
+ *  unindexItem takes it off. Both use the current text of the row.
+ ******************************************************************************/
+void ListModel::indexItem(int row)
+{
+    const Item &item = items.at(row);
+
+    if (!indexDirty) {
+        textsIndex.insert(qHash(QByteArray::fromRawData(
+                texts.constData() + item.offset, item.size)), row);
+    }
+}
+
+void ListModel::unindexItem(int row)
+{
+    const Item &item = items.at(row);
+
+    if (!indexDirty) {
+        textsIndex.remove(qHash(QByteArray::fromRawData(
+                texts.constData() + item.offset, item.size)), row);
+    }
+}
+
+void ListModel::setText(Item &item, const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+
+    wastedTexts += item.size;
+    item.offset = texts.size();
+    item.size = utf8.size();
+    texts.append(utf8);
+}
+
+void ListModel::setIcon(Item &item, const QIcon &icon)
+{
+    if (icon.isNull()) {
+        if (item.icon >= 0)
+            wastedIcons++;
+        item.icon = -1;
+    } else if (item.icon >= 0) {
+        icons[item.icon] = icon;
+    } else {
+        item.icon = icons.count();
+        icons.append(icon);
+    }
+}
+
+/*******************************************************************************
+ *  compact reclaims texts and icons storage not referred by items if it takes
+ *  more than half of the storage. Items are not moved and thus model indexes
+ *  remain valid.
+ ******************************************************************************/
+void ListModel::compact()
+{
+    if (items.isEmpty()) {
+        texts.clear();
+        icons.clear();
+        wastedTexts = wastedIcons = 0;
+        textsIndex.clear();
+        indexDirty = false;
+        return;
+    }
+
+    if (wastedTexts > texts.size() / 2) {
+        QByteArray buffer;
+
+        buffer.reserve(texts.size() - wastedTexts);
+        for (int i = 0, j = items.count(); i < j; i++) {
+            Item &item = items[i];
+            int offset = buffer.size();
+
+            buffer.append(texts.constData() + item.offset, item.size);
+            item.offset = offset;
+        }
+        texts.swap(buffer);
+        wastedTexts = 0;
+    }
+
+    if (wastedIcons > icons.count() / 2) {
+        QVector<QIcon> vector;
+
+        vector.reserve(icons.count() - wastedIcons);
+        for (int i = 0, j = items.count(); i < j; i++) {
+            Item &item = items[i];
+
+            if (item.icon >= 0) {
+                vector.append(icons.at(item.icon));
+                item.icon = vector.count() - 1;
+            }
+        }
+        icons.swap(vector);
+        wastedIcons = 0;
+    }
+}
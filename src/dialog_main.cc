@@ -66,6 +66,7 @@ int main(int argc, char *argv[])
     QApplication app(argc, argv);
     bool resizable = false;
     bool hidden = false;
+    bool buffered = true;
 
     // Consider QApplication has removed everything it recognized...
     for (int i = 1; i < argc; i++) {
@@ -85,11 +86,16 @@ int main(int argc, char *argv[])
             hidden = true;
             continue;
         }
+        if (!strcmp(argv[i], "-u") || !strcmp(argv[i], "--unbuffered")) {
+            buffered = false;
+            continue;
+        }
         fprintf(stderr, "Error: Unrecognized option %s\n", argv[i]);
         return E_ARG;
     }
 
-    DialogBox dialog(default_title, about_html_message, resizable);
+    DialogBox dialog(default_title, about_html_message, resizable, stdout,
+                     buffered);
     DialogParser parser(&dialog);
 
     parser.start();
@@ -119,16 +125,20 @@ static void help()
         "  -v, --version output version information and exit\n"
         "  -r, --resizable make the dialog resizable\n"
         "  -d, --hidden  don't show the dialog until explicit 'show' command\n"
+        "  -u, --unbuffered write out each output line immediately\n"
         "\n"
         "Supported commands:\n"
         "  - add type [title] [name] [options] [text] [auxtext]\n"
+        "  - append name [options] text\n"
+        "  - begin\n"
         "  - clear [name]\n"
+        "  - commit\n"
         "  - disable [name]\n"
         "  - enable [name]\n"
         "  - end [type]\n"
         "  - hide [name]\n"
         "  - position [options] name\n"
-        "  - query\n"
+        "  - query [statistics]\n"
         "  - remove name\n"
         "  - set [name] options [text]\n"
         "  - show [name]\n"
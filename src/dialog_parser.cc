@@ -20,6 +20,13 @@
  *------------------------------------------------------------------------------
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "dialogbox.h"
 
 using namespace DialogCommandTokens;
@@ -27,20 +34,25 @@ using namespace DialogCommandTokens;
 DialogParser::DialogParser(DialogBox *parent, FILE *in) :
     QThread(parent),
     dialog(parent),
-    input(in)
+    input(in),
+    descriptor(fileno(in)),
+    inputIndex(0),
+    inputSize(0)
 {
     command = NoopCommand;
     control = WidgetMask;
     stage = StageCommand;
-    token = bufferIndex = 0;
+    // The first byte of the buffer is reserved for the empty string
+    token = bufferIndex = 1;
+    buffer.resize(BUFFER_SIZE);
 
-    qRegisterMetaType<DialogCommand>("DialogCommand");
-    // Qt::BlockingQueuedConnection type is used to ensure commands are executed
-    // sequentially. This avoids races e.g. show hide show sequence in v1.0.
+    // Qt::DirectConnection type is used to put commands onto the dialog's
+    // queue from this thread. The dialog executes them sequentially in the GUI
+    // thread. This avoids races e.g. show hide show sequence in v1.0.
     if (parent) {
-        connect(this, SIGNAL(sendCommand(DialogCommand)), parent,
-                SLOT(executeCommand(DialogCommand)),
-                Qt::BlockingQueuedConnection);
+        connect(this, SIGNAL(sendCommand(const DialogCommand &)), parent,
+                SLOT(queueCommand(const DialogCommand &)),
+                Qt::DirectConnection);
     }
 }
 
@@ -55,16 +67,16 @@ DialogParser::~DialogParser()
 void DialogParser::setParent(DialogBox *parent)
 {
     if (dialog) {
-        disconnect(this, SIGNAL(sendCommand(DialogCommand)),
-                   dialog, SLOT(executeCommand(DialogCommand)));
+        disconnect(this, SIGNAL(sendCommand(const DialogCommand &)),
+                   dialog, SLOT(queueCommand(const DialogCommand &)));
     }
 
     dialog = parent;
     QObject::setParent(parent);
     if (parent) {
-        connect(this, SIGNAL(sendCommand(DialogCommand)), parent,
-                SLOT(executeCommand(DialogCommand)),
-                Qt::BlockingQueuedConnection);
+        connect(this, SIGNAL(sendCommand(const DialogCommand &)), parent,
+                SLOT(queueCommand(const DialogCommand &)),
+                Qt::DirectConnection);
     }
 }
 
@@ -82,7 +94,7 @@ void DialogParser::run()
             if (bufferIndex != token)
                 token = ++bufferIndex;
 
-            while ((c = fgetc(input)) != EOF) {
+            while ((c = readChar()) != EOF) {
                 if (isspace(c) && !quoted) {
                     if (isblank(c)) {
                         if (bufferIndex == token)
@@ -111,18 +123,17 @@ void DialogParser::run()
                     backslash = true;
                     continue;
                 }
+                reserveBuffer(bufferIndex + 2);
                 if (backslash && c != '"')
-                    buffer[bufferIndex++] = '\\';
+                    buffer.data()[bufferIndex++] = '\\';
                 backslash = false;
-                buffer[bufferIndex++] = c;
-
-                // We need to reserve space for backslash and terminating zero.
-                if (bufferIndex >= BUFFER_SIZE - 2)
-                    break;
+                buffer.data()[bufferIndex++] = c;
             }
+            // We need to reserve space for backslash and terminating zero.
+            reserveBuffer(bufferIndex + 2);
             if (backslash)
-                buffer[bufferIndex++] = '\\';
-            buffer[bufferIndex] = '\0';
+                buffer.data()[bufferIndex++] = '\\';
+            buffer.data()[bufferIndex] = '\0';
             processToken();
             if (endOfLine) {
                 issueCommand();
@@ -130,209 +141,343 @@ void DialogParser::run()
             }
         } while (c != EOF);
         issueCommand();
-        // Sleep for a while to reduce the CPU time consumption.
-        msleep(50);
+        waitForInput();
     }
 }
 
 /*******************************************************************************
- *  DialogParser::processToken analyses tokens and assembles commands of them.
+ *  DialogParser::fillInput reads next block of the input into the input buffer.
+ *  Returns false at end of file or on error.
  ******************************************************************************/
-void DialogParser::processToken()
+bool DialogParser::fillInput()
 {
-    const struct {
-        const char *commandKeyword;  // keyword to recognize
-        unsigned int commandCode;    // command code to assign
-        unsigned int commandStages;  // stages set to assign
-    } commandsParser[] = {
-        {"add", AddCommand,
-            StageType | StageTitle | StageName | StageOptions | StageText
-            | StageAuxText | StageCommand},
-        {"end", EndCommand, StageType | StageCommand},
-        {"position", PositionCommand, StageOptions | StageText | StageCommand},
-        {"remove", RemoveCommand, StageName | StageCommand},
-        {"clear", ClearCommand, StageName | StageCommand},
-        {"step", StepCommand, StageOptions | StageCommand},
-        {"set", SetCommand,
-            StageName | StageOptions | StageText | StageCommand},
-        {"unset", UnsetCommand, StageName | StageOptions | StageCommand},
-        {"enable", SetCommand | (OptionEnabled & OptionMask),
-            StageName | StageCommand},
-        {"disable", UnsetCommand | (OptionEnabled & OptionMask),
-            StageName | StageCommand},
-        {"show", SetCommand | (OptionVisible & OptionMask),
-            StageName | StageCommand},
-        {"hide", UnsetCommand | (OptionVisible & OptionMask),
-            StageName | StageCommand},
-        {"query", QueryCommand, StageCommand},
-        {nullptr, 0, 0}
-    };
-
-    const struct {
-        const char *controlKeyword;  // keyword to recognize
-        unsigned int controlCode;    // control type code to assign
-    } controlsParser[] = {
-        {"checkbox", CheckBoxWidget},
-        {"frame", FrameWidget},
-        {"groupbox", GroupBoxWidget},
-        {"label", LabelWidget},
-        {"pushbutton", PushButtonWidget},
-        {"radiobutton", RadioButtonWidget},
-        {"separator", SeparatorWidget},
-        {"textbox", TextBoxWidget},
-        {"listbox", ListBoxWidget},
-        {"dropdownlist", ComboBoxWidget},
-        {"combobox", ComboBoxWidget | (PropertyEditable & PropertyMask)},
-        {"item", ItemWidget},
-        {"progressbar", ProgressBarWidget},
-        {"slider", SliderWidget},
-        {"textview", TextViewWidget},
-        {"tabs", TabsWidget},
-        {"page", PageWidget},
-        {nullptr, 0}
-    };
-
-    // Each item of the array below defines properties or options of a control.
-    // If the same keyword applies to different properties/options it must be
-    // repeated as a separate item.
-    const struct {
-        const char *optionKeyword;  // keyword to recognize
-        unsigned int optionCode;    // command option or control property to set
-        bool optionReset;           // flag to reset the option
-        bool commandFlag;           // flag to process command option
-    } optionsParser[] = {
-        {"checkable", PropertyCheckable, false, false},
-        {"checked", PropertyChecked, false, false},
-        {"text", PropertyText, false, false},
-        {"title", PropertyTitle, false, false},
-        {"password", PropertyPassword, false, false},
-        {"placeholder", PropertyPlaceholder, false, false},
-        {"icon", PropertyIcon, false, false},
-        {"iconsize", PropertyIconSize, false, false},
-        {"animation", PropertyAnimation, false, false},
-        {"picture", PropertyPicture, false, false},
-        {"apply", PropertyApply, false, false},
-        {"exit", PropertyExit, false, false},
-        {"default", PropertyDefault, false, false},
-        // space and stretch are a kind of controls without options
-        {"space", OptionSpace, false, true},
-        {"stretch", OptionStretch, false, true},
-        {"behind", OptionBehind, false, true},
-        {"onto", OptionOnto, false, true},
-        {"enabled", OptionEnabled, false, true},
-        {"focus", OptionFocus, false, true},
-        {"stylesheet", OptionStyleSheet, false, true},
-        {"visible", OptionVisible, false, true},
-        {"horizontal", OptionVertical, true, true},
-        {"horizontal", PropertyVertical, true, false},
-        {"vertical", OptionVertical, false, true},
-        {"vertical", PropertyVertical, false, false},
-        {"plain", PropertyPlain, false, false},
-        {"raised", PropertyRaised, false, false},
-        {"sunken", PropertySunken, false, false},
-        {"noframe", PropertyNoframe, false, false},
-        {"box", PropertyBox, false, false},
-        {"panel", PropertyPanel, false, false},
-        {"styled", PropertyStyled, false, false},
-        {"current", PropertyCurrent, false, false},
-        {"activation", PropertyActivation, false, false},
-        {"selection", PropertySelection, false, false},
-        {"minimum", PropertyMinimum, false, false},
-        {"maximum", PropertyMaximum, false, false},
-        {"value", PropertyValue, false, false},
-        {"busy", PropertyBusy, false, false},
-        {"file", PropertyFile, false, false},
-        {"top", PropertyPositionTop, false, false},
-        {"bottom", PropertyPositionBottom, false, false},
-        {"left", PropertyPositionLeft, false, false},
-        {"right", PropertyPositionRight, false, false},
-        {nullptr, 0, false, false}
-    };
-
-    if (stage & StageCommand) {
-        int i = 0;
-
-        while (commandsParser[i].commandKeyword) {
-            if (!strcmp(buffer + token, commandsParser[i].commandKeyword)) {
-                issueCommand();
+    ssize_t size;
 
-                command = commandsParser[i].commandCode;
-                stage = commandsParser[i].commandStages;
+    while ((size = read(descriptor, inputBuffer, INPUT_BUFFER_SIZE)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // The descriptor was reopened in non-blocking mode by
+            // waitForInput(). Wait for the data the writer is yet to send.
+            struct pollfd pfd = {descriptor, POLLIN, 0};
 
-                return;
-            }
-
-            i++;
+            poll(&pfd, 1, -1);
+        } else if (errno != EINTR) {
+            break;
         }
     }
 
-    if (stage & StageType) {
-        int i = 0;
+    inputIndex = 0;
+    inputSize = size > 0 ? size : 0;
+
+    return inputSize;
+}
 
-        while (controlsParser[i].controlKeyword) {
-            if (!strcmp(buffer + token, controlsParser[i].controlKeyword)) {
-                control = controlsParser[i].controlCode;
-                stage ^= StageType;
+/*******************************************************************************
+ *  DialogParser::waitForInput blocks until more input might be available after
+ *  the end of file is reached.
+ *  A FIFO gets new writers any time (e.g. each echo command redirected to it).
+ *  It is reopened in non-blocking mode as poll() on a freshly opened FIFO
+ *  doesn't report hang up of the previous writers and waits for new data or
+ *  the next writer. Terminals block in read() by themselves. The rest (regular
+ *  files) are checked periodically to reduce the CPU time consumption.
+ ******************************************************************************/
+void DialogParser::waitForInput()
+{
+    struct stat st;
 
-                // Make bufferIndex equal to token to discard current token.
-                // Set them to zero to rewind to the beginning of the buffer.
-                bufferIndex = token = 0;
-                return;
-            }
+    if (!fstat(descriptor, &st) && S_ISFIFO(st.st_mode)) {
+        char path[32];
+        int fd;
 
-            i++;
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", descriptor);
+        if ((fd = open(path, O_RDONLY | O_NONBLOCK)) >= 0) {
+            dup2(fd, descriptor);
+            close(fd);
+
+            struct pollfd pfd = {descriptor, POLLIN, 0};
+
+            while (poll(&pfd, 1, -1) < 0 && errno == EINTR)
+                continue;
+            return;
         }
     }
 
-    if (stage & StageOptions) {
-        int i = 0;
-
-        while (optionsParser[i].optionKeyword) {
-            if (!strcmp(buffer + token, optionsParser[i].optionKeyword)) {
-                if (optionsParser[i].commandFlag) {
-                    if (optionsParser[i].optionCode & command) {
-                        if (optionsParser[i].optionReset) {
-                            // Reset option bit
-                            command &= ~(optionsParser[i].optionCode
-                                       & OptionMask);
-                        } else {
-                            // Set option bit
-                            command |= optionsParser[i].optionCode & OptionMask;
-                        }
+    if (!isatty(descriptor))
+        msleep(50);
+}
+
+/*******************************************************************************
+ *  Keywords recognized by the parser.
+ *  Each item defines the command, the control type and/or the properties or
+ *  options of a control the keyword stands for. If the same keyword applies to
+ *  different properties/options they are listed in order of precedence.
+ *  The items must be sorted by the keywords. This is verified at compile time.
+ ******************************************************************************/
+namespace {
+
+struct Keyword
+{
+    const char *keyword;         // keyword to recognize
+    unsigned int commandCode;    // command code to assign
+    unsigned int commandStages;  // stages set to assign (0 - not a command)
+    unsigned int controlCode;    // control type code to assign (0 - none)
+    struct {
+        unsigned int optionCode;  // command option or control property to set
+                                  // (0 - none)
+        bool optionReset;         // flag to reset the option
+        bool commandFlag;         // flag to process command option
+    } options[2];
+};
+
+constexpr Keyword keywords[] = {
+    {"activation", 0, 0, 0, {{PropertyActivation, false, false}}},
+    {"add", AddCommand,
+        DialogParser::StageType | DialogParser::StageTitle
+        | DialogParser::StageName | DialogParser::StageOptions
+        | DialogParser::StageText | DialogParser::StageAuxText
+        | DialogParser::StageCommand, 0, {}},
+    {"animation", 0, 0, 0, {{PropertyAnimation, false, false}}},
+    {"append", AppendCommand,
+        DialogParser::StageName | DialogParser::StageOptions
+        | DialogParser::StageText | DialogParser::StageCommand, 0, {}},
+    {"apply", 0, 0, 0, {{PropertyApply, false, false}}},
+    {"begin", BeginCommand, DialogParser::StageCommand, 0, {}},
+    {"behind", 0, 0, 0, {{OptionBehind, false, true}}},
+    {"bottom", 0, 0, 0, {{PropertyPositionBottom, false, false}}},
+    {"box", 0, 0, 0, {{PropertyBox, false, false}}},
+    {"busy", 0, 0, 0, {{PropertyBusy, false, false}}},
+    {"cachesize", 0, 0, 0, {{PropertyCacheSize, false, false}}},
+    {"checkable", 0, 0, 0, {{PropertyCheckable, false, false}}},
+    {"checkbox", 0, 0, CheckBoxWidget, {}},
+    {"checked", 0, 0, 0, {{PropertyChecked, false, false}}},
+    {"clear", ClearCommand,
+        DialogParser::StageName | DialogParser::StageCommand, 0, {}},
+    {"combobox", 0, 0, ComboBoxWidget | (PropertyEditable & PropertyMask), {}},
+    {"commit", CommitCommand, DialogParser::StageCommand, 0, {}},
+    {"current", 0, 0, 0, {{PropertyCurrent, false, false}}},
+    {"debounce", 0, 0, 0, {{PropertyDebounce, false, false}}},
+    {"default", 0, 0, 0, {{PropertyDefault, false, false}}},
+    {"disable", UnsetCommand | (OptionEnabled & OptionMask),
+        DialogParser::StageName | DialogParser::StageCommand, 0, {}},
+    {"dropdownlist", 0, 0, ComboBoxWidget, {}},
+    {"enable", SetCommand | (OptionEnabled & OptionMask),
+        DialogParser::StageName | DialogParser::StageCommand, 0, {}},
+    {"enabled", 0, 0, 0, {{OptionEnabled, false, true}}},
+    {"end", EndCommand,
+        DialogParser::StageType | DialogParser::StageCommand, 0, {}},
+    {"exit", 0, 0, 0, {{PropertyExit, false, false}}},
+    {"file", 0, 0, 0,
+        {{PropertyFile, false, false}, {PropertyItemsFile, false, false}}},
+    {"focus", 0, 0, 0, {{OptionFocus, false, true}}},
+    {"follow", 0, 0, 0, {{PropertyFollow, false, false}}},
+    {"frame", 0, 0, FrameWidget, {}},
+    {"groupbox", 0, 0, GroupBoxWidget, {}},
+    {"hide", UnsetCommand | (OptionVisible & OptionMask),
+        DialogParser::StageName | DialogParser::StageCommand, 0, {}},
+    {"horizontal", 0, 0, 0,
+        {{OptionVertical, true, true}, {PropertyVertical, true, false}}},
+    {"icon", 0, 0, 0, {{PropertyIcon, false, false}}},
+    {"iconsize", 0, 0, 0, {{PropertyIconSize, false, false}}},
+    {"item", 0, 0, ItemWidget, {}},
+    {"items", 0, 0, ItemWidget | (PropertyItems & PropertyMask), {}},
+    {"label", 0, 0, LabelWidget, {}},
+    {"left", 0, 0, 0, {{PropertyPositionLeft, false, false}}},
+    {"listbox", 0, 0, ListBoxWidget, {}},
+    {"maximum", 0, 0, 0, {{PropertyMaximum, false, false}}},
+    {"minimum", 0, 0, 0, {{PropertyMinimum, false, false}}},
+    {"noframe", 0, 0, 0, {{PropertyNoframe, false, false}}},
+    {"onto", 0, 0, 0, {{OptionOnto, false, true}}},
+    {"page", 0, 0, PageWidget, {}},
+    {"panel", 0, 0, 0, {{PropertyPanel, false, false}}},
+    {"password", 0, 0, 0, {{PropertyPassword, false, false}}},
+    {"picture", 0, 0, 0, {{PropertyPicture, false, false}}},
+    {"placeholder", 0, 0, 0, {{PropertyPlaceholder, false, false}}},
+    {"plain", 0, 0, 0, {{PropertyPlain, false, false}}},
+    {"position", PositionCommand,
+        DialogParser::StageOptions | DialogParser::StageText
+        | DialogParser::StageCommand, 0, {}},
+    {"progressbar", 0, 0, ProgressBarWidget, {}},
+    {"pushbutton", 0, 0, PushButtonWidget, {}},
+    {"query", QueryCommand,
+        DialogParser::StageOptions | DialogParser::StageCommand, 0, {}},
+    {"radiobutton", 0, 0, RadioButtonWidget, {}},
+    {"raised", 0, 0, 0, {{PropertyRaised, false, false}}},
+    {"remove", RemoveCommand,
+        DialogParser::StageName | DialogParser::StageCommand, 0, {}},
+    {"right", 0, 0, 0, {{PropertyPositionRight, false, false}}},
+    {"scroll", 0, 0, 0, {{OptionScroll, false, true}}},
+    {"selection", 0, 0, 0, {{PropertySelection, false, false}}},
+    {"separator", 0, 0, SeparatorWidget, {}},
+    {"set", SetCommand,
+        DialogParser::StageName | DialogParser::StageOptions
+        | DialogParser::StageText | DialogParser::StageCommand, 0, {}},
+    {"show", SetCommand | (OptionVisible & OptionMask),
+        DialogParser::StageName | DialogParser::StageCommand, 0, {}},
+    {"size", 0, 0, 0, {{PropertySize, false, false}}},
+    {"slider", 0, 0, SliderWidget, {}},
+    // space and stretch are a kind of controls without options
+    {"space", 0, 0, 0, {{OptionSpace, false, true}}},
+    {"statistics", 0, 0, 0, {{OptionStatistics, false, true}}},
+    {"step", StepCommand,
+        DialogParser::StageOptions | DialogParser::StageCommand, 0, {}},
+    {"stretch", 0, 0, 0, {{OptionStretch, false, true}}},
+    {"styled", 0, 0, 0, {{PropertyStyled, false, false}}},
+    {"stylesheet", 0, 0, 0, {{OptionStyleSheet, false, true}}},
+    {"sunken", 0, 0, 0, {{PropertySunken, false, false}}},
+    {"tabs", 0, 0, TabsWidget, {}},
+    {"text", 0, 0, 0, {{PropertyText, false, false}}},
+    {"textbox", 0, 0, TextBoxWidget, {}},
+    {"textview", 0, 0, TextViewWidget, {}},
+    {"title", 0, 0, 0, {{PropertyTitle, false, false}}},
+    {"top", 0, 0, 0, {{PropertyPositionTop, false, false}}},
+    {"tracking", 0, 0, 0, {{PropertyTracking, false, false}}},
+    {"unset", UnsetCommand,
+        DialogParser::StageName | DialogParser::StageOptions
+        | DialogParser::StageCommand, 0, {}},
+    {"value", 0, 0, 0, {{PropertyValue, false, false}}},
+    {"vertical", 0, 0, 0,
+        {{OptionVertical, false, true}, {PropertyVertical, false, false}}},
+    {"visible", 0, 0, 0, {{OptionVisible, false, true}}},
+};
+
+constexpr int keywordsCount = sizeof(keywords) / sizeof(keywords[0]);
+
+constexpr int compareKeywords(const char *a, const char *b)
+{
+    return *a != *b || !*a ? *a - *b : compareKeywords(a + 1, b + 1);
+}
 
-                        stage &= ~(StageTitle | StageName);
+constexpr bool keywordsSorted(int i = 1)
+{
+    return i >= keywordsCount
+           || (compareKeywords(keywords[i - 1].keyword, keywords[i].keyword) < 0
+               && keywordsSorted(i + 1));
+}
+
+static_assert(keywordsSorted(), "keywords must be sorted");
+
+// Index of the first keyword starting with the given or a greater character
+constexpr int firstKeyword(char c, int i = 0)
+{
+    return i < keywordsCount && keywords[i].keyword[0] < c
+           ? firstKeyword(c, i + 1) : i;
+}
+
+// Ranges of keywords by their first letter
+constexpr int keywordsIndex[] = {
+    firstKeyword('a'), firstKeyword('b'), firstKeyword('c'), firstKeyword('d'),
+    firstKeyword('e'), firstKeyword('f'), firstKeyword('g'), firstKeyword('h'),
+    firstKeyword('i'), firstKeyword('j'), firstKeyword('k'), firstKeyword('l'),
+    firstKeyword('m'), firstKeyword('n'), firstKeyword('o'), firstKeyword('p'),
+    firstKeyword('q'), firstKeyword('r'), firstKeyword('s'), firstKeyword('t'),
+    firstKeyword('u'), firstKeyword('v'), firstKeyword('w'), firstKeyword('x'),
+    firstKeyword('y'), firstKeyword('z'), keywordsCount
+};
+
+/*******************************************************************************
+ *  findKeyword looks the token up in the keywords table. The range of keywords
+ *  with the same first letter is selected by the index and is searched by
+ *  bisection.
+ ******************************************************************************/
+const Keyword *findKeyword(const char *token)
+{
+    unsigned int letter = (unsigned char)token[0] - 'a';
 
-                        // Make bufferIndex equal to token to discard current
-                        // token
-                        bufferIndex = token;
-                        return;
+    if (letter >= 26)
+        return nullptr;
+
+    int first = keywordsIndex[letter];
+    int last = keywordsIndex[letter + 1];
+
+    while (first < last) {
+        int middle = (first + last) / 2;
+        int result = strcmp(token + 1, keywords[middle].keyword + 1);
+
+        if (!result)
+            return keywords + middle;
+        if (result < 0)
+            last = middle;
+        else
+            first = middle + 1;
+    }
+
+    return nullptr;
+}
+
+}  // namespace
+
+/*******************************************************************************
+ *  DialogParser::processToken analyses tokens and assembles commands of them.
+ ******************************************************************************/
+void DialogParser::processToken()
+{
+    const Keyword *keyword = findKeyword(buffer.constData() + token);
+
+    if (stage & StageCommand && keyword && keyword->commandStages) {
+        issueCommand();
+
+        command = keyword->commandCode;
+        stage = keyword->commandStages;
+
+        return;
+    }
+
+    if (stage & StageType && keyword && keyword->controlCode) {
+        control = keyword->controlCode;
+        stage ^= StageType;
+
+        // Make bufferIndex equal to token to discard current token.
+        // Set them to one to rewind to the beginning of the buffer
+        // (behind the empty string).
+        bufferIndex = token = 1;
+        return;
+    }
+
+    if (stage & StageOptions && keyword) {
+        for (int i = 0; i < 2 && keyword->options[i].optionCode; i++) {
+            unsigned int optionCode = keyword->options[i].optionCode;
+
+            if (keyword->options[i].commandFlag) {
+                if (optionCode & command) {
+                    if (keyword->options[i].optionReset) {
+                        // Reset option bit
+                        command &= ~(optionCode & OptionMask);
+                    } else {
+                        // Set option bit
+                        command |= optionCode & OptionMask;
                     }
-                } else {
-                    if (optionsParser[i].optionCode & control) {
-                        // Make control type more specific
-                        control &= optionsParser[i].optionCode | PropertyMask;
-
-                        if (optionsParser[i].optionReset) {
-                            // Reset property bit
-                            control &= ~(optionsParser[i].optionCode
-                                       & PropertyMask);
-                        } else {
-                            // Set property bit
-                            control |= optionsParser[i].optionCode
-                                       & PropertyMask;
-                        }
 
-                        stage &= ~(StageTitle | StageName);
+                    stage &= ~(StageTitle | StageName);
 
-                        // Make bufferIndex equal to token to discard current
-                        // token
-                        bufferIndex = token;
-                        return;
+                    // Make bufferIndex equal to token to discard current token
+                    bufferIndex = token;
+                    return;
+                }
+            } else {
+                // The file option is for items only. For a single item the
+                // keyword is either its text or its icon file name.
+                if (optionCode == PropertyItemsFile
+                    && !(control & PropertyItems & PropertyMask))
+                    continue;
+
+                if (optionCode & control) {
+                    // Make control type more specific
+                    control &= optionCode | PropertyMask;
+
+                    if (keyword->options[i].optionReset) {
+                        // Reset property bit
+                        control &= ~(optionCode & PropertyMask);
+                    } else {
+                        // Set property bit
+                        control |= optionCode & PropertyMask;
                     }
+
+                    stage &= ~(StageTitle | StageName);
+
+                    // Make bufferIndex equal to token to discard current token
+                    bufferIndex = token;
+                    return;
                 }
             }
-
-            i++;
         }
     }
 
@@ -344,7 +489,7 @@ void DialogParser::processToken()
         // Set token to be different from bufferIndex.
         // This indicates the token was recognized.
         // Next, values for bufferIndex and token will be set in run() function.
-        token = BUFFER_SIZE;
+        token = SIZE_MAX;
         return;
     }
 
@@ -352,7 +497,7 @@ void DialogParser::processToken()
         name = token;
         stage ^= StageName;
 
-        token = BUFFER_SIZE;
+        token = SIZE_MAX;
         return;
     }
 
@@ -360,14 +505,14 @@ void DialogParser::processToken()
         text = token;
         stage ^= StageText;
 
-        token = BUFFER_SIZE;
+        token = SIZE_MAX;
         return;
     }
     if (stage & StageAuxText) {
         auxtext = token;
         stage ^= StageAuxText;
 
-        token = BUFFER_SIZE;
+        token = SIZE_MAX;
         return;
     }
 
@@ -378,12 +523,24 @@ void DialogParser::processToken()
 void DialogParser::issueCommand()
 {
     if (command != NoopCommand) {
-        emit sendCommand(*this);
+        DialogCommand issued(*this);
+        int size = qMin(bufferIndex + 1, (size_t)buffer.size());
+
+        if (size > BUFFER_SIZE) {
+            // Move large payload to the command and start a new buffer
+            buffer = QByteArray(BUFFER_SIZE, '\0');
+            issued.buffer.truncate(size);
+        } else {
+            // Small command costs only what it uses. The buffer is reused.
+            issued.buffer = QByteArray(buffer.constData(), size);
+        }
+
+        emit sendCommand(issued);
 
         command = NoopCommand;
         control = WidgetMask;
         stage = StageCommand;
-        title = name = text = auxtext = BUFFER_SIZE - 1;
-        token = bufferIndex = 0;
+        title = name = text = auxtext = 0;
+        token = bufferIndex = 1;
     }
 }
@@ -31,14 +31,36 @@ using namespace DialogCommandTokens;
  ******************************************************************************/
 
 /*******************************************************************************
- *  updateTabsOrder sets widgets focus order in way they are shown on the
- *  dialog, not they are created.
- *  It walks through the given or current (the currentLayout is on) page only.
+ *  updateTabsOrder marks the given or current (the currentLayout is on) page
+ *  for focus order update. The update itself is done by applyTabsOrder once
+ *  per page when the batch of commands is executed.
  ******************************************************************************/
 void DialogBox::updateTabsOrder(QWidget *page)
 {
-    QBoxLayout *mainLayout = (QBoxLayout *)(page ? page->layout() :
-                                            currentLayout->parent()->parent());
+    if (!page)
+        page = currentLayout->parent()->parent()->parentWidget();
+    tabsOrderPages.insert(page);
+}
+
+/*******************************************************************************
+ *  applyTabsOrder updates focus order on all pages marked by updateTabsOrder.
+ ******************************************************************************/
+void DialogBox::applyTabsOrder()
+{
+    QSet<QObject *>::const_iterator i;
+
+    for (i = tabsOrderPages.constBegin(); i != tabsOrderPages.constEnd(); ++i)
+        setTabsOrder((QWidget *)*i);
+    tabsOrderPages.clear();
+}
+
+/*******************************************************************************
+ *  setTabsOrder sets widgets focus order in way they are shown on the page,
+ *  not they are created.
+ ******************************************************************************/
+void DialogBox::setTabsOrder(QWidget *page)
+{
+    QBoxLayout *mainLayout = (QBoxLayout *)page->layout();
     QWidget *prevWidget = nullptr;
     QWidget *widget;
 
@@ -141,10 +163,15 @@ bool DialogBox::removeIfEmpty(QLayout *layout)
 /*******************************************************************************
  *  sanitizeLayout prevents fantom layouts. Must be called for end layouts ONLY
  *  (3rd or 4th level). Actually for the 4th level layout it removes spacer
- *  items only.
+ *  items only. Within a transaction the layout is sanitized on commit.
  ******************************************************************************/
 void DialogBox::sanitizeLayout(QLayout *layout)
 {
+    if (transactionDepth) {
+        pendingLayouts.append(layout);
+        return;
+    }
+
     if (isEmpty(layout) && layout->count()) {
         // Remove all QSpacerItem items
         while (QLayoutItem *li = layout->takeAt(0))
@@ -154,6 +181,492 @@ void DialogBox::sanitizeLayout(QLayout *layout)
     removeIfEmpty(layout);
 }
 
+/*******************************************************************************
+ *  widgetProperty returns the handle of the widget property. Handles are
+ *  resolved once per widget class and are kept in the properties index.
+ *  Properties the class doesn't have are returned as invalid handles.
+ ******************************************************************************/
+static const char *propertyNames[] = {
+    "default",
+    "checked",
+    "checkable",
+    "echoMode",
+    "placeholderText",
+    "text",
+    "title",
+    "windowTitle",
+    "pixmap",
+    "icon",
+    "windowIcon",
+    "iconSize",
+    "frameShadow",
+    "frameShape",
+    "minimum",
+    "maximum",
+    "value",
+    "tabPosition",
+};
+static_assert(sizeof(propertyNames) / sizeof(*propertyNames)
+              == DialogBox::PropertiesCount, "propertyNames mismatch");
+
+QMetaProperty DialogBox::widgetProperty(QWidget *widget,
+                                        enum WidgetProperty property)
+{
+    const QMetaObject *metaObj = widget->metaObject();
+    QHash<const QMetaObject *, QVector<QMetaProperty> >::const_iterator i =
+            propertiesIndex.constFind(metaObj);
+
+    if (i == propertiesIndex.constEnd()) {
+        QVector<QMetaProperty> properties(PropertiesCount);
+
+        for (int j = 0; j < PropertiesCount; j++) {
+            properties[j] = metaObj->property(
+                    metaObj->indexOfProperty(propertyNames[j]));
+        }
+        i = propertiesIndex.insert(metaObj, properties);
+    }
+
+    return i->at(property);
+}
+
+/*******************************************************************************
+ *  flushOutput completes output of an event. Buffered output is written out
+ *  once the control returns to the event loop, so lines of all events handled
+ *  meanwhile (e.g. of a whole query) are written at once.
+ ******************************************************************************/
+void DialogBox::flushOutput()
+{
+    if (!outputBuffered) {
+        fflush(output);
+    } else if (!flushPending) {
+        flushPending = true;
+        QTimer::singleShot(0, this, SLOT(writeOutput()));
+    }
+}
+
+/*******************************************************************************
+ *  setCurrentItem makes the row of the current list widget the current one.
+ ******************************************************************************/
+void DialogBox::setCurrentItem(int row)
+{
+    if (widgetType(currentListWidget) == ComboBoxWidget)
+        ((QComboBox *)currentListWidget)->setCurrentIndex(row);
+    else
+        currentView->setCurrentIndex(currentView->model()->index(row, 0));
+}
+
+/*******************************************************************************
+ *  processPendingEvents processes events generated by the former show, hide or
+ *  stylesheet change if any. Such calls generate events which are optimised
+ *  next or set widget attributes which might impact next calls. To avoid races
+ *  (e.g. of show, hide, show sequence) the events are processed before the
+ *  next such call and at the end of the commands batch instead of after each
+ *  command.
+ ******************************************************************************/
+void DialogBox::processPendingEvents()
+{
+    if (eventsPending) {
+        eventsPending = false;
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents
+                                        | QEventLoop::ExcludeSocketNotifiers);
+    }
+}
+
+/*******************************************************************************
+ *  printStatistics outputs the dialog box counters. Their names are prefixed
+ *  with "statistics:" as the colon symbol never appears in widget names.
+ ******************************************************************************/
+void DialogBox::printStatistics()
+{
+    unsigned long coalesced;
+
+    queueMutex.lock();
+    coalesced = coalescedCommands;
+    queueMutex.unlock();
+
+    fprintf(output, "statistics:coalesced=%lu\n", coalesced);
+    fprintf(output, "statistics:transactions=%lu\n", transactionsCount);
+    fprintf(output, "statistics:transactiontime=%lld\n",
+            (long long)transactionTime);
+    fprintf(output, "statistics:pixmaphits=%lu\n", pixmapHits);
+    fprintf(output, "statistics:pixmapmisses=%lu\n", pixmapMisses);
+    fprintf(output, "statistics:iconhits=%lu\n", iconHits);
+    fprintf(output, "statistics:iconmisses=%lu\n", iconMisses);
+    flushOutput();
+}
+
+/*******************************************************************************
+ *  pixmapKey returns the QPixmapCache key for the picture from the given file
+ *  fitted into the given size. The key includes modification time and size
+ *  of the file, so a rewritten file isn't served from the cache.
+ ******************************************************************************/
+QString DialogBox::pixmapKey(const QString &file, const QSize &size)
+{
+    QFileInfo info(file);
+
+    return QString("dialogbox:%1x%2:%3:%4:")
+           .arg(size.width()).arg(size.height())
+           .arg(info.lastModified().toMSecsSinceEpoch()).arg(info.size())
+           + file;
+}
+
+/*******************************************************************************
+ *  loadPicture sets the picture from the given file to the label. Pictures
+ *  larger than the label size (see the size option) are scaled down while
+ *  they are decoded. Decoded pictures are kept in QPixmapCache so repeated
+ *  requests share the same pixmap data. The cache limit is set with the
+ *  cachesize option.
+ *  Pictures missing in the cache are decoded by PictureLoader on a thread of
+ *  the loadersPool. Until the picture is delivered to pictureLoaded slot the
+ *  label shows a blank placeholder of the picture size.
+ ******************************************************************************/
+void DialogBox::loadPicture(QWidget *label, const QString &file)
+{
+    QPixmap pixmap;
+
+    cancelPictureLoad(label);
+
+    if (file.isEmpty()) {
+        picturesIndex.remove(label);
+        ((QLabel *)label)->setPixmap(pixmap);
+        return;
+    }
+
+    picturesIndex.insert(label, file);
+
+    QSize size = sizesIndex.value(label);
+    QString key = pixmapKey(file, size);
+
+    if (QPixmapCache::find(key, &pixmap)) {
+        pixmapHits++;
+        ((QLabel *)label)->setPixmap(pixmap); // QLabel copies QPixmap object
+        return;
+    }
+
+    pixmapMisses++;
+
+    // Only the image header is read here
+    QSize imageSize = QImageReader(file).size();
+    QSize scaledSize = PictureLoader::fitSize(imageSize, size);
+
+    if (scaledSize.isValid())
+        imageSize = scaledSize;
+    if (imageSize.isValid()) {
+        pixmap = QPixmap(imageSize);
+        pixmap.fill(Qt::transparent);
+    }
+    ((QLabel *)label)->setPixmap(pixmap);
+
+    PictureLoad load;
+
+    load.label = label;
+    load.key = key;
+    load.cancelled = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+    pictureLoads.insert(++pictureLoadId, load);
+
+    loadersPool.start(new PictureLoader(this, pictureLoadId, file, size,
+                                        load.cancelled));
+}
+
+/*******************************************************************************
+ *  cancelPictureLoad drops the picture being decoded for the label if any.
+ ******************************************************************************/
+void DialogBox::cancelPictureLoad(QWidget *label)
+{
+    QHash<int, PictureLoad>::iterator it = pictureLoads.begin();
+
+    while (it != pictureLoads.end()) {
+        if (it->label == label || it->label.isNull()) {
+            *it->cancelled = 1;
+            it = pictureLoads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/*******************************************************************************
+ *  loadMovie sets the animation from the given file to the label. Frames
+ *  larger than the label size (see the size option) are scaled down.
+ *  The animation runs only while the label is visible (see eventFilter).
+ ******************************************************************************/
+void DialogBox::loadMovie(QWidget *label, const QString &file)
+{
+    QMovie *mv = new QMovie(file);
+    QSize scaledSize = PictureLoader::fitSize(QImageReader(file).size(),
+                                              sizesIndex.value(label));
+
+    if (scaledSize.isValid())
+        mv->setScaledSize(scaledSize);
+
+    ((QLabel *)label)->setMovie(mv); // QLabel stores pointer to QMovie object
+    mv->setParent(label);
+    mv->start();  // Decodes the first frame
+
+    // The label isn't visible until it is shown by its layout
+    if (!label->isVisible())
+        mv->setPaused(true);
+    label->installEventFilter(this);  // Installed once only
+}
+
+/*******************************************************************************
+ *  setLabelSize sets the size pictures and animations of the label are fitted
+ *  into. Invalid size means no limit. The current content is refitted.
+ ******************************************************************************/
+void DialogBox::setLabelSize(QWidget *label, const QSize &size)
+{
+    if (size.isValid())
+        sizesIndex.insert(label, size);
+    else
+        sizesIndex.remove(label);
+
+    QMovie *mv;
+
+    if ((mv = ((QLabel *)label)->movie())) {
+        // Invalid size restores the original frames size
+        mv->setScaledSize(PictureLoader::fitSize(
+                QImageReader(mv->fileName()).size(), size));
+    } else if (picturesIndex.contains(label)) {
+        loadPicture(label, picturesIndex.value(label));
+    }
+}
+
+/*******************************************************************************
+ *  parseSize converts text in either "<width>x<height>" or "<size>" format to
+ *  the size. The latter is a square. Invalid size is returned on failure.
+ ******************************************************************************/
+QSize DialogBox::parseSize(const char *text)
+{
+    int width, height;
+
+    switch (sscanf(text ? text : "", "%dx%d", &width, &height)) {
+    case 1:
+        return QSize(width, width);
+    case 2:
+        return QSize(width, height);
+    default:
+        return QSize();
+    }
+}
+
+/*******************************************************************************
+ *  loadText starts reading the given text file into the textview. The file is
+ *  read by TextLoader on a thread of the loadersPool and its content replaces
+ *  the current one once the first chunk is delivered to textLoaded slot.
+ *  The load being in progress for the textview is cancelled. Empty file name
+ *  makes the textview forget its file.
+ ******************************************************************************/
+void DialogBox::loadText(QWidget *viewer, const QString &file)
+{
+    TextFile &textFile = textFilesIndex[viewer];
+
+    cancelTextLoad(viewer);
+
+    textFile.name = file;
+    textFile.size = -1;
+    if (file.isEmpty() && !textFile.follow)
+        textFilesIndex.remove(viewer);
+    updateFilesWatcher();
+
+    if (file.isEmpty())
+        return;
+
+    TextLoad load;
+
+    load.viewer = viewer;
+    load.cancelled = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+    load.chunks = QSharedPointer<QSemaphore>(
+            new QSemaphore(TEXT_CHUNKS_PENDING));
+    textLoads.insert(++textLoadId, load);
+
+    loadersPool.start(new TextLoader(this, textLoadId, file, load.cancelled,
+                                     load.chunks));
+}
+
+/*******************************************************************************
+ *  cancelTextLoad stops reading the text file for the textview if any.
+ *  Loads for removed textviews are cancelled as well.
+ ******************************************************************************/
+void DialogBox::cancelTextLoad(QWidget *viewer)
+{
+    QHash<int, TextLoad>::iterator it = textLoads.begin();
+
+    while (it != textLoads.end()) {
+        if (it->viewer == viewer || it->viewer.isNull()) {
+            *it->cancelled = 1;
+            it = textLoads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/*******************************************************************************
+ *  setFollow turns on or off the follow mode of the textview. In this mode
+ *  bytes appended to the file are displayed as soon as the file changes.
+ *  Only whole lines are displayed and the oldest lines are removed if there
+ *  are more than the given number of them. Zero means no limit.
+ ******************************************************************************/
+void DialogBox::setFollow(QWidget *viewer, bool follow, int lines)
+{
+    ((QTextEdit *)viewer)->document()->setMaximumBlockCount(
+            follow && lines > 0 ? lines : 0);
+
+    if (!textFilesIndex.contains(viewer)) {
+        if (!follow)
+            return;
+        textFilesIndex[viewer].size = -1;
+    }
+
+    TextFile &textFile = textFilesIndex[viewer];
+
+    textFile.follow = follow;
+    if (!follow && textFile.name.isEmpty())
+        textFilesIndex.remove(viewer);
+    updateFilesWatcher();
+
+    // Catch up with the file if it is loaded already
+    if (follow)
+        readAppendedText(viewer);
+}
+
+/*******************************************************************************
+ *  updateFilesWatcher makes filesWatcher watch the followed files only. For
+ *  the followed files which don't exist (yet) their directories are watched
+ *  instead, so the files are loaded once they are created.
+ ******************************************************************************/
+void DialogBox::updateFilesWatcher()
+{
+    QStringList watched = filesWatcher.files() + filesWatcher.directories();
+    QSet<QString> followed;
+
+    for (QHash<QObject *, TextFile>::const_iterator it =
+             textFilesIndex.constBegin();
+         it != textFilesIndex.constEnd(); ++it) {
+        if (it->follow && !it->name.isEmpty()) {
+            if (QFile::exists(it->name))
+                followed.insert(it->name);
+            else
+                followed.insert(QFileInfo(it->name).absolutePath());
+        }
+    }
+
+    for (int i = 0, j = watched.count(); i < j; i++) {
+        if (!followed.remove(watched.at(i)))
+            filesWatcher.removePath(watched.at(i));
+    }
+
+    // Paths removed meanwhile can't be watched
+    for (QSet<QString>::const_iterator it = followed.constBegin();
+         it != followed.constEnd(); ++it) {
+        if (QFileInfo(*it).exists())
+            filesWatcher.addPath(*it);
+    }
+}
+
+/*******************************************************************************
+ *  readAppendedText appends the whole lines appended to the file of the
+ *  textview since it was displayed. A truncated (e.g. rotated) file is loaded
+ *  again. The textview keeps showing the end of the file if it did.
+ ******************************************************************************/
+void DialogBox::readAppendedText(QWidget *viewer)
+{
+    TextFile &textFile = textFilesIndex[viewer];
+
+    if (textFile.size < 0)
+        return;  // Being loaded
+
+    QFile txt(textFile.name);
+
+    if (!txt.open(QFile::ReadOnly))
+        return;
+
+    if (txt.size() < textFile.size) {
+        loadText(viewer, textFile.name);
+        return;
+    }
+
+    if (txt.size() == textFile.size || !txt.seek(textFile.size))
+        return;
+
+    QByteArray data = txt.readAll();
+    int size = data.lastIndexOf('\n') + 1;
+
+    if (!size)
+        return;  // Wait for the line to be completed
+
+    data.truncate(size);
+    textFile.size += size;
+
+    QScrollBar *scrollBar = ((QTextEdit *)viewer)->verticalScrollBar();
+    bool bottom = scrollBar->value() == scrollBar->maximum();
+
+    appendText(viewer, QString::fromLocal8Bit(data.constData(), size),
+               bottom);
+}
+
+/*******************************************************************************
+ *  appendText appends the text at the end of the textview document. Only the
+ *  new text is laid out. With scroll set the textview is scrolled to the end.
+ ******************************************************************************/
+void DialogBox::appendText(QWidget *viewer, const QString &text, bool scroll)
+{
+    QTextCursor cursor(((QTextEdit *)viewer)->document());
+
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+
+    if (scroll) {
+        QScrollBar *scrollBar = ((QTextEdit *)viewer)->verticalScrollBar();
+
+        scrollBar->setValue(scrollBar->maximum());
+    }
+}
+
+/*******************************************************************************
+ *  loadIcon returns the icon from the given file. Icons larger than the given
+ *  size (the icon size of the widget) are decoded straight to the size fitted
+ *  into it. The file is added to the icon as well, so it is decoded in full
+ *  only if the icon is drawn larger later (e.g. by iconsize option or by
+ *  stylesheet). Icons are kept in the iconsCache so the items sharing the same
+ *  icon file share the icon engine and the pixmaps it renders.
+ ******************************************************************************/
+QIcon DialogBox::loadIcon(const char *file, const QSize &size)
+{
+    if (!file || !file[0])
+        return QIcon();
+
+    QString path(file);
+    QString key = pixmapKey(path, size);
+    QIcon *icon;
+
+    if ((icon = iconsCache.object(key))) {
+        iconHits++;
+        return *icon;
+    }
+
+    iconMisses++;
+
+    QImageReader reader(path);
+    QSize imageSize = reader.size();
+    QSize scaledSize = PictureLoader::fitSize(imageSize, size);
+
+    if (scaledSize.isValid()) {
+        reader.setScaledSize(scaledSize);
+        icon = new QIcon(QPixmap::fromImage(reader.read()));
+        // With the size given the file isn't read until it is the best match
+        icon->addFile(path, imageSize);
+    } else {
+        icon = new QIcon(path);
+    }
+    if (icon->isNull()) {
+        delete icon;
+        return QIcon();
+    }
+    iconsCache.insert(key, icon);  // The cache takes ownership
+    return *icon;
+}
+
 /*******************************************************************************
  *  sanitizeLabel prepares label for changing its content type
  ******************************************************************************/
@@ -163,6 +676,9 @@ void DialogBox::sanitizeLabel(QWidget *label, enum ContentType content)
         QMovie *mv;
         QLayout *layout;
 
+        cancelPictureLoad(label);
+        picturesIndex.remove(label);
+
         if ((mv = ((QLabel *)label)->movie()))
             delete mv;
         ((QLabel *)label)->clear();
@@ -234,29 +750,26 @@ void DialogBox::printWidget(QWidget *widget)
 
         if (name[0]) {
             QWidget *proxyWidget;
-            const QMetaObject *metaObj = widget->metaObject();
-            int propertyIndex;
+            QMetaProperty property;
 
-            if (metaObj->property(metaObj->indexOfProperty("checkable"))
-                .read(widget).toBool()) {
+            if (widgetProperty(widget, CheckableProperty).read(widget)
+                .toBool()) {
                 fprintf(output, "%s=%s\n", name,
-                        metaObj->property(metaObj->indexOfProperty("checked"))
-                        .read(widget).toBool() ? "1" : "0");
-                fflush(output);
+                        widgetProperty(widget, CheckedProperty).read(widget)
+                        .toBool() ? "1" : "0");
+                flushOutput();
                 return;
             }
 
-            if ((propertyIndex = metaObj->indexOfProperty("value")) >= 0
+            if ((property = widgetProperty(widget, ValueProperty)).isValid()
                 && widgetType(widget) != ProgressBarWidget) {
                 fprintf(output, "%s=%d\n", name,
-                        metaObj->property(propertyIndex).read(widget).toInt());
-                fflush(output);
+                        property.read(widget).toInt());
+                flushOutput();
                 return;
             }
 
             if ((proxyWidget = widget->focusProxy())) {
-                QListWidgetItem *item;
-
                 fprintf(output, "%s=", name);
                 switch ((unsigned)widgetType(proxyWidget)) {
                 case ComboBoxWidget:
@@ -265,19 +778,18 @@ void DialogBox::printWidget(QWidget *widget)
                             .toLocal8Bit().constData());
                     break;
                 case ListBoxWidget:
-                    item = ((QListWidget *)proxyWidget)->currentItem();
                     fprintf(output, "%s\n",
-                            item ? item->text().toLocal8Bit().constData() : "");
+                            ((ListBox *)proxyWidget)->currentIndex().data()
+                            .toString().toLocal8Bit().constData());
                     break;
                 default:
-                    metaObj = proxyWidget->metaObject();
                     fprintf(output, "%s\n",
-                            metaObj->property(metaObj->indexOfProperty("text"))
+                            widgetProperty(proxyWidget, TextProperty)
                             .read(proxyWidget).toString().toLocal8Bit()
                             .constData());
                     break;
                 }
-                fflush(output);
+                flushOutput();
                 return;
             }
         }
@@ -46,19 +46,13 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
         return;
 
     QWidget *proxyWidget;
-    const QMetaObject *metaObj = widget->metaObject();
-    const QMetaObject *proxyMetaObj;
     QMetaProperty property;
 
-    if ( (proxyWidget = widget->focusProxy()) ) {
-        proxyMetaObj = proxyWidget->metaObject();
-    } else {
+    if ( !(proxyWidget = widget->focusProxy()) )
         proxyWidget = widget;
-        proxyMetaObj = metaObj;
-    }
 
     if (type & PropertyDefault && mask & PropertyDefault & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("default"));
+        property = widgetProperty(widget, DefaultProperty);
         if (property.isWritable()) {
             property.write(widget,
                     QVariant((bool)(options & PropertyDefault & PropertyMask)));
@@ -71,7 +65,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     }
 
     if (type & PropertyChecked && mask & PropertyChecked & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("checked"));
+        property = widgetProperty(widget, CheckedProperty);
         if (property.isWritable()) {
             property.write(widget,
                            QVariant(options & PropertyChecked & PropertyMask));
@@ -79,7 +73,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     }
 
     if (type & PropertyCheckable && mask & PropertyCheckable & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("checkable"));
+        property = widgetProperty(widget, CheckableProperty);
         if (property.isWritable()) {
             property.write(widget,
                     QVariant(options & PropertyCheckable & PropertyMask));
@@ -94,8 +88,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
 
     // Password makes sense for QLineEdit objects only
     if (type & PropertyPassword && mask & PropertyPassword & PropertyMask) {
-        property = proxyMetaObj->property(
-                proxyMetaObj->indexOfProperty("echoMode"));
+        property = widgetProperty(proxyWidget, EchoModeProperty);
         if (property.isWritable()) {
             property.write(proxyWidget,
                            QVariant(options & PropertyPassword & PropertyMask
@@ -107,8 +100,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     // Placeholder makes sense for QLineEdit objects only
     if (type & PropertyPlaceholder
         && mask & PropertyPlaceholder & PropertyMask) {
-        property = proxyMetaObj->property(
-                proxyMetaObj->indexOfProperty("placeholderText"));
+        property = widgetProperty(proxyWidget, PlaceholderTextProperty);
         if (property.isWritable()) {
             property.write(proxyWidget,
                            QVariant(QString(options & PropertyPlaceholder
@@ -124,8 +116,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
         if (proxyWidget != widget
             && (type == TextBoxWidget || (type == ComboBoxWidget
             && (leWidget = ((QComboBox *)proxyWidget)->lineEdit())) )) {
-            const QMetaObject *leMetaObj = leWidget->metaObject();
-            property = leMetaObj->property(leMetaObj->indexOfProperty("text"));
+            property = widgetProperty(leWidget, TextProperty);
             if (property.isWritable()) {
                 property.write(leWidget,
                                QVariant(QString(options & PropertyText
@@ -163,14 +154,14 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
         }
         default:
             if (// QGroupBox objects
-                (property = metaObj->property(
-                    metaObj->indexOfProperty("title"))).isWritable()
+                (property = widgetProperty(widget, TitleProperty))
+                    .isWritable()
                 // the rest widgets
-                || (property = metaObj->property(
-                    metaObj->indexOfProperty("text"))).isWritable()
+                || (property = widgetProperty(widget, TextProperty))
+                    .isWritable()
                 // the main window (QDialog object)
-                || (property = metaObj->property(
-                    metaObj->indexOfProperty("windowTitle"))).isWritable()) {
+                || (property = widgetProperty(widget, WindowTitleProperty))
+                    .isWritable()) {
                 // Avoid to format labels of joint widgets (which have
                 // focusProxy set)
                 if (widget == proxyWidget)
@@ -192,12 +183,8 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     if (type & PropertyAnimation && mask & PropertyAnimation & PropertyMask) {
         // There is no movie property for QLabel objects
         sanitizeLabel(widget, MovieContent);
-        if (QMovie *mv = new QMovie(options & PropertyAnimation & PropertyMask
-                                    ? text : nullptr)) {
-            ((QLabel *)widget)->setMovie(mv);
-            mv->start();
-            mv->setParent(widget);
-        }
+        loadMovie(widget, options & PropertyAnimation & PropertyMask
+                          ? text : nullptr);
     }
 
     // Picture makes sense for QLabel objects only.
@@ -206,51 +193,69 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     // DialogCommandTokens::Control enum distinguishes between QLabel and label
     // of QLineEdit.
     if (type & PropertyPicture && mask & PropertyPicture & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("pixmap"));
+        property = widgetProperty(widget, PixmapProperty);
         if (property.isWritable()) {
             sanitizeLabel(widget, PixmapContent);
-            property.write(widget,
-                           QVariant(QPixmap(options & PropertyPicture
-                                            & PropertyMask ? text : nullptr)));
+            loadPicture(widget, options & PropertyPicture & PropertyMask
+                                ? text : nullptr);
         }
     }
 
+    // Size makes sense for QLabel objects only (see the picture above)
+    if (type & PropertySize && mask & PropertySize & PropertyMask) {
+        setLabelSize(widget, options & PropertySize & PropertyMask
+                             ? parseSize(text) : QSize());
+    }
+
     if (type & PropertyIcon && mask & PropertyIcon & PropertyMask) {
         switch (type) {
         case ItemWidget: {
             QAbstractItemModel *model = chosenView->model();
             if (chosenRow >= 0) {
                 model->setData(model->index(chosenRow, 0),
-                               QIcon(options & PropertyIcon & PropertyMask
-                                     ? text : nullptr), Qt::DecorationRole);
+                               loadIcon(options & PropertyIcon
+                                        & PropertyMask ? text : nullptr,
+                                        chosenView->iconSize()),
+                               Qt::DecorationRole);
             }
             break;
         }
         case PageWidget: {
             QTabWidget *tabs = (QTabWidget *)widget->parent()->parent();
             tabs->setTabIcon(tabs->indexOf(widget),
-                             QIcon(options & PropertyIcon & PropertyMask
-                                   ? text : nullptr));
+                             loadIcon(options & PropertyIcon & PropertyMask
+                                      ? text : nullptr, tabs->iconSize()));
             break;
         }
         default:
-            if ((property = metaObj->property(
-                    metaObj->indexOfProperty("icon"))).isWritable()
-                || (property = metaObj->property(
-                    metaObj->indexOfProperty("windowIcon"))).isWritable()) {
+            if ((property = widgetProperty(widget, IconProperty))
+                    .isWritable()
+                || (property = widgetProperty(widget, WindowIconProperty))
+                    .isWritable()) {
+                QSize size = widgetProperty(widget, IconSizeProperty)
+                             .read(widget).toSize();
+
                 property.write(widget,
-                               QVariant(QIcon(options & PropertyIcon
-                                              & PropertyMask
-                                              ? text : nullptr)));
+                               QVariant(loadIcon(options & PropertyIcon
+                                                 & PropertyMask
+                                                 ? text : nullptr, size)));
             }
         }
     }
 
+    // Cache size makes sense for the dialog only
+    if (type & PropertyCacheSize && mask & PropertyCacheSize & PropertyMask) {
+        int size = PIXMAP_CACHE_SIZE;
+
+        if (options & PropertyCacheSize & PropertyMask && text[0])
+            sscanf(text, "%d", &size);
+        QPixmapCache::setCacheLimit(size);
+    }
+
     // Iconsize makes sense for set command only
     if (type & PropertyIconSize && mask & PropertyIconSize & PropertyMask
         && options & PropertyIconSize & PropertyMask) {
-        property = proxyMetaObj->property(
-                proxyMetaObj->indexOfProperty("iconSize"));
+        property = widgetProperty(proxyWidget, IconSizeProperty);
         if (property.isWritable()) {
             if (text[0]) {
                 int size;
@@ -263,27 +268,27 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     // below three shadow options make sense for set command only
     if (type & PropertyRaised && mask & PropertyRaised & PropertyMask
         && options & PropertyRaised & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("frameShadow"));
+        property = widgetProperty(widget, FrameShadowProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QFrame::Raised));
     }
 
     if (type & PropertySunken && mask & PropertySunken & PropertyMask
         && options & PropertySunken & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("frameShadow"));
+        property = widgetProperty(widget, FrameShadowProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QFrame::Sunken));
     }
 
     if (type & PropertyPlain && mask & PropertyPlain & PropertyMask
         && options & PropertyPlain & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("frameShadow"));
+        property = widgetProperty(widget, FrameShadowProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QFrame::Plain));
     }
 
     if (type & PropertyBox && mask & PropertyBox & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("frameShape"));
+        property = widgetProperty(widget, FrameShapeProperty);
         if (property.isWritable()) {
             property.write(widget, QVariant(options & PropertyBox & PropertyMask
                                             ? QFrame::Box : QFrame::NoFrame));
@@ -291,7 +296,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     }
 
     if (type & PropertyPanel && mask & PropertyPanel & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("frameShape"));
+        property = widgetProperty(widget, FrameShapeProperty);
         if (property.isWritable()) {
             property.write(widget,
                            QVariant(options & PropertyPanel & PropertyMask
@@ -300,7 +305,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     }
 
     if (type & PropertyStyled && mask & PropertyStyled & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("frameShape"));
+        property = widgetProperty(widget, FrameShapeProperty);
         if (property.isWritable()) {
             property.write(widget,
                            QVariant(options & PropertyStyled & PropertyMask
@@ -311,7 +316,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     // Noframe shape option makes sense for set command only
     if (type & PropertyNoframe && mask & PropertyNoframe & PropertyMask
         && options & PropertyNoframe & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("frameShape"));
+        property = widgetProperty(widget, FrameShapeProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QFrame::NoFrame));
     }
@@ -371,14 +376,12 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
             break;
         case ListBoxWidget:
             disconnect(proxyWidget,
-                       SIGNAL(currentItemChanged(QListWidgetItem *,
-                                                 QListWidgetItem *)),
-                       this, SLOT(listBoxItemSelected(QListWidgetItem *)));
+                       SIGNAL(currentItemChanged(const QModelIndex &)),
+                       this, SLOT(listBoxItemSelected(const QModelIndex &)));
             if (options & PropertySelection & PropertyMask) {
                 connect(proxyWidget,
-                        SIGNAL(currentItemChanged(QListWidgetItem *,
-                                                  QListWidgetItem *)),
-                        this, SLOT(listBoxItemSelected(QListWidgetItem *)));
+                        SIGNAL(currentItemChanged(const QModelIndex &)),
+                        this, SLOT(listBoxItemSelected(const QModelIndex &)));
             }
             break;
         }
@@ -408,7 +411,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     }
 
     if (type & PropertyMinimum && mask & PropertyMinimum & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("minimum"));
+        property = widgetProperty(widget, MinimumProperty);
         if (property.isWritable()) {
             int min = 0;
 
@@ -419,7 +422,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     }
 
     if (type & PropertyMaximum && mask & PropertyMaximum & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("maximum"));
+        property = widgetProperty(widget, MaximumProperty);
         if (property.isWritable()) {
             int max = 100;
 
@@ -431,7 +434,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
 
     // reset() for QProgressBar objects must be done in the class specific way
     if (type & PropertyValue && mask & PropertyValue & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("value"));
+        property = widgetProperty(widget, ValueProperty);
         if (property.isWritable()) {
             if (!(options & PropertyValue & PropertyMask)
                 && type == ProgressBarWidget) {
@@ -445,9 +448,26 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
         }
     }
 
+    // Tracking and debounce make sense for Slider objects only
+    if (type & PropertyTracking && mask & PropertyTracking & PropertyMask) {
+        ((Slider *)widget)->setTracking(options & PropertyTracking
+                                        & PropertyMask);
+    }
+
+    if (type & PropertyDebounce && mask & PropertyDebounce & PropertyMask) {
+        int interval = 0;
+
+        if (options & PropertyDebounce & PropertyMask) {
+            interval = DEBOUNCE_INTERVAL;
+            if (text[0])
+                sscanf(text, "%d", &interval);
+        }
+        ((Slider *)widget)->setDebounceInterval(interval);
+    }
+
     // Busy makes sense for QProgressBar objects only
     if (type & PropertyBusy && mask & PropertyBusy & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("maximum"));
+        property = widgetProperty(widget, MaximumProperty);
         if (property.isWritable()) {
             property.write(widget,
                            QVariant(options & PropertyBusy & PropertyMask
@@ -458,19 +478,27 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     // File makes sense for QTextEdit objects only
     if (type & PropertyFile && mask & PropertyFile & PropertyMask) {
         if (options & PropertyFile & PropertyMask) {
-            QFile txt(text);
-            if (txt.open(QFile::ReadOnly))
-                ((QTextEdit *)widget)->setText(QTextStream(&txt).readAll());
+            loadText(widget, text);
         } else {
+            loadText(widget, QString());
             ((QTextEdit *)widget)->clear();
         }
     }
 
+    // Follow makes sense for QTextEdit objects only
+    if (type & PropertyFollow && mask & PropertyFollow & PropertyMask) {
+        int lines = FOLLOW_LINES;
+
+        if (options & PropertyFollow & PropertyMask && text[0])
+            sscanf(text, "%d", &lines);
+        setFollow(widget, options & PropertyFollow & PropertyMask, lines);
+    }
+
     // Below four position options make sense for set command only and for
     // QTabWidget objects only
     if (type & PropertyPositionTop && mask & PropertyPositionTop & PropertyMask
         && options & PropertyPositionTop & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("tabPosition"));
+        property = widgetProperty(widget, TabPositionProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QTabWidget::North));
     }
@@ -478,7 +506,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     if (type & PropertyPositionBottom
         && mask & PropertyPositionBottom & PropertyMask
         && options & PropertyPositionBottom & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("tabPosition"));
+        property = widgetProperty(widget, TabPositionProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QTabWidget::South));
     }
@@ -486,7 +514,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     if (type & PropertyPositionLeft
         && mask & PropertyPositionLeft & PropertyMask
         && options & PropertyPositionLeft & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("tabPosition"));
+        property = widgetProperty(widget, TabPositionProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QTabWidget::West));
     }
@@ -494,7 +522,7 @@ void DialogBox::setOptions(QWidget *widget, unsigned int options,
     if (type & PropertyPositionRight
         && mask & PropertyPositionRight & PropertyMask
         && options & PropertyPositionRight & PropertyMask) {
-        property = metaObj->property(metaObj->indexOfProperty("tabPosition"));
+        property = widgetProperty(widget, TabPositionProperty);
         if (property.isWritable())
             property.write(widget, QVariant(QTabWidget::East));
     }
@@ -35,10 +35,13 @@ void DialogBox::done(int r)
 }
 
 /*******************************************************************************
- *  Slot function. Removes page widget from pages list.
+ *  Slot function. Removes page widget from pages list and from pages pending
+ *  focus order update.
  ******************************************************************************/
 void DialogBox::removePage(QObject *page)
 {
+    tabsOrderPages.remove(page);
+
     for (int i = 0, j = pages.count(); i < j; i++) {
         if ((QObject *)pages.at(i) == page) {
             pages.removeAt(i);
@@ -47,6 +50,46 @@ void DialogBox::removePage(QObject *page)
     }
 }
 
+/*******************************************************************************
+ *  Slot function. Removes destroyed widget from the widgets indexes. The name
+ *  is removed only if it refers to this widget.
+ ******************************************************************************/
+void DialogBox::unregisterWidget(QObject *widget)
+{
+    layoutsIndex.remove(widget);
+    typesIndex.remove(widget);
+    picturesIndex.remove(widget);
+    sizesIndex.remove(widget);
+    if (textFilesIndex.remove(widget))
+        updateFilesWatcher();
+
+    QByteArray key = widget->objectName().toLocal8Bit();
+    QHash<QByteArray, QWidget *>::iterator i = namesIndex.find(key);
+
+    if (i == namesIndex.end() || (QObject *)i.value() != widget)
+        return;
+
+    namesIndex.erase(i);
+
+    // Pass the name on to another widget which has it, if any, as findChild
+    // would find it. Widgets being destroyed are already out of typesIndex.
+    if (duplicateNames.contains(key)) {
+        QList<QWidget *> list = findChildren<QWidget *>(widget->objectName());
+
+        duplicateNames.remove(key);
+        for (int j = 0, k = list.count(); j < k; j++) {
+            if ((QObject *)list.at(j) == widget
+                || !typesIndex.contains(list.at(j)))
+                continue;
+            if (namesIndex.contains(key)) {
+                duplicateNames.insert(key);
+                break;
+            }
+            namesIndex.insert(key, list.at(j));
+        }
+    }
+}
+
 /*******************************************************************************
  *  Slot function. Reports values of all reportable enabled widgets.
  ******************************************************************************/
@@ -56,6 +99,142 @@ void DialogBox::report()
         printWidgetsRecursively(pages.at(i)->layout());
 }
 
+/*******************************************************************************
+ *  Slot function. Writes the buffered output out.
+ ******************************************************************************/
+void DialogBox::writeOutput()
+{
+    flushPending = false;
+    fflush(output);
+}
+
+/*******************************************************************************
+ *  Slot function. Sets the picture decoded by PictureLoader to the label it was
+ *  loaded for. Pictures of cancelled loads are dropped.
+ ******************************************************************************/
+void DialogBox::pictureLoaded(int id, const QImage &image)
+{
+    QHash<int, PictureLoad>::iterator it = pictureLoads.find(id);
+
+    if (it == pictureLoads.end())
+        return;
+
+    QPixmap pixmap = QPixmap::fromImage(image);
+
+    if (!pixmap.isNull())
+        QPixmapCache::insert(it->key, pixmap);
+    if (!it->label.isNull())
+        ((QLabel *)it->label.data())->setPixmap(pixmap);
+
+    pictureLoads.erase(it);
+}
+
+/*******************************************************************************
+ *  Slot function. Appends the chunk of the text file read by TextLoader to the
+ *  textview it is loaded for. The first chunk replaces the textview content
+ *  and sets its format. Reading stops if the textview is removed.
+ *  Once the last chunk is appended the textview catches up with the followed
+ *  file.
+ ******************************************************************************/
+void DialogBox::textLoaded(int id, const QString &text, bool first, bool last,
+                           qint64 size)
+{
+    QHash<int, TextLoad>::iterator it = textLoads.find(id);
+
+    if (it == textLoads.end())
+        return;
+
+    if (it->viewer.isNull()) {
+        *it->cancelled = 1;
+        textLoads.erase(it);
+        return;
+    }
+
+    QTextEdit *viewer = (QTextEdit *)it->viewer.data();
+
+    if (first)
+        viewer->setText(text);  // Detects rich text
+    else
+        appendText(viewer, text, false);
+
+    if (last) {
+        textLoads.erase(it);
+        textFilesIndex[viewer].size = size;
+        if (textFilesIndex[viewer].follow)
+            readAppendedText(viewer);
+    } else {
+        it->chunks->release();  // Let the loader deliver the next chunk
+    }
+}
+
+/*******************************************************************************
+ *  Slot function. Displays text appended to the file by textviews which follow
+ *  it. Files replaced by new ones (e.g. on rotation) are dropped by the
+ *  watcher, so they are watched again. Removed files are waited for in their
+ *  directories.
+ ******************************************************************************/
+void DialogBox::followedFileChanged(const QString &file)
+{
+    for (QHash<QObject *, TextFile>::iterator it = textFilesIndex.begin();
+         it != textFilesIndex.end(); ++it) {
+        if (it->follow && it->name == file)
+            readAppendedText((QWidget *)it.key());
+    }
+
+    updateFilesWatcher();
+}
+
+/*******************************************************************************
+ *  Slot function. Loads followed files which were missing (not created yet or
+ *  removed on rotation) once they appear in the directory.
+ ******************************************************************************/
+void DialogBox::followedDirectoryChanged(const QString &dir)
+{
+    QStringList watched = filesWatcher.files();
+    QList<QWidget *> appeared;
+
+    for (QHash<QObject *, TextFile>::const_iterator it =
+             textFilesIndex.constBegin();
+         it != textFilesIndex.constEnd(); ++it) {
+        if (it->follow && !it->name.isEmpty() && !watched.contains(it->name)
+            && QFileInfo(it->name).absolutePath() == dir
+            && QFile::exists(it->name))
+            appeared.append((QWidget *)it.key());
+    }
+
+    // loadText updates the index and the watcher so it is called afterwards
+    for (int i = 0, j = appeared.count(); i < j; i++)
+        loadText(appeared.at(i), textFilesIndex.value(appeared.at(i)).name);
+
+    updateFilesWatcher();
+}
+
+/*******************************************************************************
+ *  Event filter. Reimplemented. Pauses animation of the label once the label
+ *  gets hidden (incl. hidden tab pages and minimized dialog box) and resumes
+ *  it once the label is shown so idle animations don't waste CPU time.
+ *  Animations which aren't running (e.g. finished) are left intact.
+ ******************************************************************************/
+bool DialogBox::eventFilter(QObject *object, QEvent *event)
+{
+    if (event->type() == QEvent::Hide || event->type() == QEvent::Show) {
+        QMovie *mv;
+
+        if (object->isWidgetType()
+            && widgetType((QWidget *)object) == LabelWidget
+            && (mv = ((QLabel *)object)->movie())) {
+            if (event->type() == QEvent::Hide
+                && mv->state() == QMovie::Running)
+                mv->setPaused(true);
+            else if (event->type() == QEvent::Show
+                     && mv->state() == QMovie::Paused)
+                mv->setPaused(false);
+        }
+    }
+
+    return QDialog::eventFilter(object, event);
+}
+
 /*******************************************************************************
  *  Slot function. Reports the pushbutton is clicked.
  ******************************************************************************/
@@ -66,7 +245,7 @@ void DialogBox::pushButtonClicked()
 
     if (objectName[0] && !pb->isCheckable()) {
         fprintf(output, "%s=clicked\n", objectName);
-        fflush(output);
+        flushOutput();
     }
 }
 
@@ -81,7 +260,7 @@ void DialogBox::pushButtonToggled(bool checked)
     if (objectName[0]) {
         fprintf(output, "%s=%s\n", objectName,
                 checked ? "pressed" : "released");
-        fflush(output);
+        flushOutput();
     }
 }
 
@@ -101,7 +280,7 @@ void DialogBox::listBoxItemActivated(const QModelIndex &index)
             fprintf(output, "%s=", objectName);
             fprintf(output, "%s\n",
                     index.data().toString().toLocal8Bit().constData());
-            fflush(output);
+            flushOutput();
         }
     }
 }
@@ -109,7 +288,7 @@ void DialogBox::listBoxItemActivated(const QModelIndex &index)
 /*******************************************************************************
  *  Slot function. Reports the current item of the listbox is changed.
  ******************************************************************************/
-void DialogBox::listBoxItemSelected(QListWidgetItem *current)
+void DialogBox::listBoxItemSelected(const QModelIndex &current)
 {
     ListBox *list = (ListBox *)sender();
     QLayout *layout;
@@ -121,8 +300,8 @@ void DialogBox::listBoxItemSelected(QListWidgetItem *current)
         if (objectName[0]) {
             fprintf(output, "%s=", objectName);
             fprintf(output, "%s\n",
-                    current ? current->text().toLocal8Bit().constData() : "");
-            fflush(output);
+                    current.data().toString().toLocal8Bit().constData());
+            flushOutput();
         }
     }
 }
@@ -143,7 +322,7 @@ void DialogBox::comboBoxItemSelected(int index)
             fprintf(output, "%s=", objectName);
             fprintf(output, "%s\n",
                     list->itemText(index).toLocal8Bit().constData());
-            fflush(output);
+            flushOutput();
         }
     }
 }
@@ -157,7 +336,7 @@ void DialogBox::sliderValueChanged(int value)
 
     if (objectName[0]) {
         fprintf(output, "%s=%d\n", objectName, value);
-        fflush(output);
+        flushOutput();
     }
 }
 
@@ -184,10 +363,114 @@ void DialogBox::sliderRangeChanged(int min, int max)
 }
 
 /*******************************************************************************
- *  Slot function. Translates command object recevied from the parser thread
- *  to appropriate function call.
+ *  isSuperseding returns true if the command makes the queued one redundant.
+ *  This is the case for consecutive set commands which update the same single
+ *  value-like option (value, text or title) of the same widget. Such commands
+ *  have no side effects which depend on the former value.
+ *  Items referred by their text (<list>:<text>) are excluded for text and title
+ *  options as the former command renames the item the latter one refers to.
+ ******************************************************************************/
+static bool isSuperseding(const DialogCommand &command,
+                          const DialogCommand &queued)
+{
+    if (command.command != SetCommand || queued.command != SetCommand
+        || command.control != queued.control)
+        return false;
+
+    const char *name = command.buffer.constData() + command.name;
+
+    switch (command.control) {
+    case PropertyText:
+    case PropertyTitle:
+        if (strchr(name, ':'))
+            return false;
+        // Fall through
+    case PropertyValue:
+        return !strcmp(name, queued.buffer.constData() + queued.name);
+    }
+
+    return false;
+}
+
+/*******************************************************************************
+ *  Slot function. Is called in the parser thread. Puts the command onto the
+ *  queue and schedules its execution in the GUI thread. The parser is blocked
+ *  only when the queue is full.
+ *  A queued command not executed yet is replaced if the command supersedes it.
+ ******************************************************************************/
+void DialogBox::queueCommand(const DialogCommand &command)
+{
+    QMutexLocker locker(&queueMutex);
+
+    if (!commandQueue.isEmpty()
+        && isSuperseding(command, commandQueue.last())) {
+        commandQueue.last() = command;
+        coalescedCommands++;
+        return;
+    }
+
+    while (commandQueue.count() >= COMMAND_QUEUE_SIZE)
+        queueDrained.wait(&queueMutex);
+
+    commandQueue.append(command);
+
+    // Schedule the execution for the first command only. The rest ones are
+    // executed by the same executeCommands call.
+    if (commandQueue.count() == 1) {
+        QMetaObject::invokeMethod(this, "executeCommands",
+                                  Qt::QueuedConnection);
+    }
+}
+
+/*******************************************************************************
+ *  Slot function. Executes all the commands queued by the parser thread in the
+ *  order they were received.
+ ******************************************************************************/
+void DialogBox::executeCommands()
+{
+    QList<DialogCommand> commands;
+
+    // Some commands process pending events and thus might call this slot
+    // recursively. Commands queued meanwhile must not overtake the current
+    // ones. They are executed by the loop below.
+    if (executing)
+        return;
+    executing = true;
+
+    while (true) {
+        queueMutex.lock();
+        commands.swap(commandQueue);
+        queueDrained.wakeAll();
+        queueMutex.unlock();
+
+        if (commands.isEmpty()) {
+            if (!eventsPending)
+                break;
+            // A call of this slot scheduled for commands queued while the
+            // events are processed returns at once. The commands are picked up
+            // by the next iteration.
+            processPendingEvents();
+            continue;
+        }
+
+        for (int i = 0, j = commands.count(); i < j; i++) {
+            executeCommand(commands[i]);
+            Q_ASSERT(checkLayoutsIndex());
+        }
+        commands.clear();
+    }
+
+    if (!transactionDepth)
+        applyTabsOrder();
+
+    executing = false;
+}
+
+/*******************************************************************************
+ *  Translates command object recevied from the parser thread to appropriate
+ *  function call.
  ******************************************************************************/
-void DialogBox::executeCommand(DialogCommand command)
+void DialogBox::executeCommand(DialogCommand &command)
 {
     QWidget *widget = nullptr;
 
@@ -221,7 +504,9 @@ void DialogBox::executeCommand(DialogCommand command)
                      command.control & PropertyPicture & PropertyMask
                      ? PixmapContent
                      : command.control & PropertyAnimation & PropertyMask
-                     ? MovieContent : TextContent);
+                     ? MovieContent : TextContent,
+                     command.control & PropertySize & PropertyMask
+                     ? parseSize(command.getText()) : QSize());
             break;
         case GroupBoxWidget:
             addGroupBox(command.getTitle(), command.getName(),
@@ -264,6 +549,14 @@ void DialogBox::executeCommand(DialogCommand command)
                         command.control & PropertySelection & PropertyMask);
             break;
         case ItemWidget:
+            if (command.control & PropertyItemsFile & PropertyMask) {
+                addItems(command.getText(), true);
+                break;
+            }
+            if (command.control & PropertyItems & PropertyMask) {
+                addItems(command.getTitle());
+                break;
+            }
             addItem(command.getTitle(), command.getName(),
                     command.control & PropertyCurrent & PropertyMask);
             break;
@@ -287,7 +580,8 @@ void DialogBox::executeCommand(DialogCommand command)
                 sscanf(command.getText(), "%d", &max);
             addSlider(command.getTitle(),
                       command.control & PropertyVertical & PropertyMask,
-                      min, max);
+                      min, max,
+                      command.control & PropertyDebounce & PropertyMask);
             break;
         }
         case TextViewWidget:
@@ -379,28 +673,26 @@ void DialogBox::executeCommand(DialogCommand command)
 
         // See http://doc.qt.io/qt-4.8/stylesheet.html for reference
         if (command.command & OptionStyleSheet & OptionMask) {
+            processPendingEvents();
             widget->setStyleSheet(command.getText());
             if (QWidget *proxyWidget = widget->focusProxy())
                 proxyWidget->setStyleSheet(command.getText());
         }
 
         if (command.command & OptionVisible & OptionMask) {
+            processPendingEvents();
             widget->show();
             if (QWidget *proxyWidget = widget->focusProxy())
                 proxyWidget->show();
         }
 
+        if (command.command & (OptionStyleSheet | OptionVisible) & OptionMask)
+            eventsPending = true;
+
         if (command.control) {
             setOptions(widget, command.control, command.control,
                        command.getText());
         }
-
-        // Setting of some properties (calls like show and hide) generates
-        // events which are optimised next or sets widget attributes which might
-        // impact next calls. To avoid races and to ensure the command is
-        // executed as expected we process all events that have been generated:
-        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents
-                                        | QEventLoop::ExcludeSocketNotifiers);
         break;
     case UnsetCommand:
         if (command.getName()[0]) {
@@ -419,26 +711,24 @@ void DialogBox::executeCommand(DialogCommand command)
             // empty string). Hopefully this was caused by the race which is now
             // fixed (queued signaling between threads and optimisation of
             // queued GUI events).
+            processPendingEvents();
             widget->setStyleSheet(QString());
             if (QWidget *proxywidget = widget->focusProxy())
                 proxywidget->setStyleSheet(QString());
         }
 
         if (command.command & OptionVisible & OptionMask) {
+            processPendingEvents();
             widget->hide();
             if (QWidget *proxywidget = widget->focusProxy())
                 proxywidget->hide();
         }
 
+        if (command.command & (OptionStyleSheet | OptionVisible) & OptionMask)
+            eventsPending = true;
+
         if (command.control)
             setOptions(widget, 0, command.control, nullptr);
-
-        // Setting of some properties (calls like show and hide) generates
-        // events which are optimised next or sets widget attributes which might
-        // impact next calls. To avoid races and to ensure the command is
-        // executed as expected we process all events that have been generated:
-        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents
-                                        | QEventLoop::ExcludeSocketNotifiers);
         break;
     case RemoveCommand:
         removeWidget(command.getName());
@@ -448,7 +738,20 @@ void DialogBox::executeCommand(DialogCommand command)
                  command.command & OptionOnto & OptionMask);
         break;
     case QueryCommand:
-        report();
+        if (command.command & OptionStatistics & OptionMask)
+            printStatistics();
+        else
+            report();
+        break;
+    case AppendCommand:
+        append(command.getName(), command.getText(),
+               command.command & OptionScroll & OptionMask);
+        break;
+    case BeginCommand:
+        beginTransaction();
+        break;
+    case CommitCommand:
+        commitTransaction();
         break;
     case NoopCommand:
     default:
@@ -30,7 +30,7 @@ static const char *aboutLabel = "_dbabout_";
  *  DialogBox constructor
  ******************************************************************************/
 DialogBox::DialogBox(const char *title, const char *about, bool resizable,
-                     FILE *out):
+                     FILE *out, bool buffered):
     defaultPushButton(nullptr),
     currentLayout(new QVBoxLayout),
     currentIndex(0),
@@ -39,7 +39,22 @@ DialogBox::DialogBox(const char *title, const char *about, bool resizable,
     currentListWidget(nullptr),
     currentTabsWidget(nullptr),
     output(out),
-    empty(true)
+    outputBuffered(buffered),
+    flushPending(false),
+    empty(true),
+    executing(false),
+    eventsPending(false),
+    coalescedCommands(0),
+    transactionDepth(0),
+    transactionsCount(0),
+    transactionTime(0),
+    iconsCache(ICONS_CACHE_SIZE),
+    pixmapHits(0),
+    pixmapMisses(0),
+    iconHits(0),
+    iconMisses(0),
+    pictureLoadId(0),
+    textLoadId(0)
 {
 
     QVBoxLayout *mainLayout = new QVBoxLayout;
@@ -59,26 +74,136 @@ DialogBox::DialogBox(const char *title, const char *about, bool resizable,
 
     pages.append(this);
 
+    if (outputBuffered) {
+        // Lines are written out by flushOutput only. The buffer must outlive
+        // the dialog as the stream might be used after it is destroyed.
+        static char buffer[OUTPUT_BUFFER_SIZE];
+        setvbuf(output, buffer, _IOFBF, sizeof(buffer));
+    }
+
     setWindowTitle(title);
+    connect(&filesWatcher, SIGNAL(fileChanged(const QString &)), this,
+            SLOT(followedFileChanged(const QString &)));
+    connect(&filesWatcher, SIGNAL(directoryChanged(const QString &)), this,
+            SLOT(followedDirectoryChanged(const QString &)));
+
     if (about)
         addLabel(about, aboutLabel);
 }
 
+/*******************************************************************************
+ *  DialogBox destructor
+ ******************************************************************************/
+DialogBox::~DialogBox()
+{
+    // Delete child widgets while the indexes are still alive as their
+    // destroyed() signals are connected to this object's slots.
+    QObjectList list = children();
+
+    for (int i = 0, j = list.count(); i < j; i++) {
+        if (list.at(i)->isWidgetType())
+            delete list.at(i);
+    }
+
+    // Loaders deliver their results to this object, wait for the running ones
+    for (QHash<int, PictureLoad>::iterator it = pictureLoads.begin();
+         it != pictureLoads.end(); ++it) {
+        *it->cancelled = 1;
+    }
+    for (QHash<int, TextLoad>::iterator it = textLoads.begin();
+         it != textLoads.end(); ++it) {
+        *it->cancelled = 1;
+    }
+    loadersPool.waitForDone();
+
+    fflush(output);
+}
+
 /*******************************************************************************
  *  Widget management methods
  ******************************************************************************/
 
+/*******************************************************************************
+ *  registerWidget names the widget and puts it onto the names and types
+ *  indexes. The widget is removed from the indexes once it is destroyed either
+ *  explicitly or by its parent.
+ ******************************************************************************/
+void DialogBox::registerWidget(QWidget *widget, const char *name,
+                               DialogCommandTokens::Control type)
+{
+    widget->setObjectName(QString(name));
+    indexType(widget, type);
+
+    QByteArray key = widget->objectName().toLocal8Bit();
+
+    // Names must be unique. If not, the first widget is found as it was
+    // before the index was introduced.
+    if (!key.isEmpty()) {
+        if (!namesIndex.contains(key))
+            namesIndex.insert(key, widget);
+        else
+            duplicateNames.insert(key);
+    }
+}
+
+/*******************************************************************************
+ *  indexType records the widget type. Proxies of joint widgets are recorded
+ *  with the type of the joint widget.
+ ******************************************************************************/
+void DialogBox::indexType(QWidget *widget, DialogCommandTokens::Control type)
+{
+    typesIndex.insert(widget, type);
+    connect(widget, SIGNAL(destroyed(QObject *)), this,
+            SLOT(unregisterWidget(QObject *)), Qt::UniqueConnection);
+}
+
+/*******************************************************************************
+ *  indexLayout records the layout the widget is laid on. The record is removed
+ *  once the widget is destroyed.
+ ******************************************************************************/
+void DialogBox::indexLayout(QWidget *widget, QLayout *layout)
+{
+    layoutsIndex.insert(widget, layout);
+    connect(widget, SIGNAL(destroyed(QObject *)), this,
+            SLOT(unregisterWidget(QObject *)), Qt::UniqueConnection);
+}
+
+/*******************************************************************************
+ *  insertWidget puts the widget at the current position.
+ ******************************************************************************/
+void DialogBox::insertWidget(QWidget *widget)
+{
+    if (groupLayout) {
+        groupLayout->insertWidget(groupIndex++, widget);
+        indexLayout(widget, groupLayout);
+    } else {
+        currentLayout->insertWidget(currentIndex++, widget);
+        indexLayout(widget, currentLayout);
+    }
+}
+
+/*******************************************************************************
+ *  insertLayout puts the layout of a joint widget at the current position.
+ ******************************************************************************/
+void DialogBox::insertLayout(QBoxLayout *layout)
+{
+    if (groupLayout)
+        groupLayout->insertLayout(groupIndex++, layout);
+    else
+        currentLayout->insertLayout(currentIndex++, layout);
+
+    for (int i = 0, j = layout->count(); i < j; i++)
+        indexLayout(layout->itemAt(i)->widget(), layout);
+}
+
 void DialogBox::addPushButton(const char *title, const char *name, bool apply,
                               bool exit, bool def)
 {
     QPushButton *pb = new QPushButton(title);
 
-    pb->setObjectName(QString(name));
+    registerWidget(pb, name, PushButtonWidget);
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, pb);
-    else
-        currentLayout->insertWidget(currentIndex++, pb);
+    insertWidget(pb);
 
     connect(pb, SIGNAL(clicked()), this, SLOT(pushButtonClicked()));
     connect(pb, SIGNAL(toggled(bool)), this, SLOT(pushButtonToggled(bool)));
@@ -103,13 +228,10 @@ void DialogBox::addCheckBox(const char *title, const char *name, bool checked)
 {
     QCheckBox *cb = new QCheckBox(title);
 
-    cb->setObjectName(QString(name));
+    registerWidget(cb, name, CheckBoxWidget);
     cb->setChecked(checked);
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, cb);
-    else
-        currentLayout->insertWidget(currentIndex++, cb);
+    insertWidget(cb);
 
     updateTabsOrder();
 }
@@ -119,43 +241,35 @@ void DialogBox::addRadioButton(const char *title, const char *name,
 {
     QRadioButton *rb = new QRadioButton(title);
 
-    rb->setObjectName(QString(name));
+    registerWidget(rb, name, RadioButtonWidget);
     rb->setChecked(checked);
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, rb);
-    else
-        currentLayout->insertWidget(currentIndex++, rb);
+    insertWidget(rb);
 
     updateTabsOrder();
 }
 
 void DialogBox::addLabel(const char *title, const char *name,
-                         enum ContentType content)
+                         enum ContentType content, const QSize &size)
 {
     QLabel *lb = new QLabel;
 
-    lb->setObjectName(QString(name));
+    registerWidget(lb, name, LabelWidget);
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, lb);
-    else
-        currentLayout->insertWidget(currentIndex++, lb);
+    insertWidget(lb);
 
     sanitizeLabel(lb, content);
 
+    if (size.isValid())
+        sizesIndex.insert(lb, size);
+
     switch (content) {
     case PixmapContent:
-        lb->setPixmap(QPixmap(title)); // QLabel copies QPixmap object
+        loadPicture(lb, title);
         break;
-    case MovieContent: {
-        QMovie *mv = new QMovie(title);
-
-        lb->setMovie(mv); // QLabel stores pointer to QMovie object
-        mv->setParent(lb);
-        mv->start();
+    case MovieContent:
+        loadMovie(lb, title);
         break;
-    }
     default:
         lb->setText(title); // QLabel copies QString object
         break;
@@ -167,7 +281,7 @@ void DialogBox::addGroupBox(const char *title, const char *name, bool vertical,
 {
     QGroupBox *gb = new QGroupBox(title);
 
-    gb->setObjectName(QString(name));
+    registerWidget(gb, name, GroupBoxWidget);
     gb->setCheckable(checkable);
     gb->setChecked(checked);
 
@@ -177,6 +291,7 @@ void DialogBox::addGroupBox(const char *title, const char *name, bool vertical,
     gb->setLayout(groupLayout);
     groupLayout->setAlignment(LAYOUTS_ALIGNMENT);
     currentLayout->insertWidget(currentIndex++, gb);
+    indexLayout(gb, currentLayout);
 
     updateTabsOrder();
 }
@@ -186,7 +301,7 @@ void DialogBox::addFrame(const char *name, bool vertical, unsigned int style)
     unsigned int shape, shadow;
     QFrame *frame = new QFrame;
 
-    frame->setObjectName(QString(name));
+    registerWidget(frame, name, FrameWidget);
 
     // Style is a DialogCommandTokens::Control value
     style &= PropertyMask;
@@ -209,6 +324,7 @@ void DialogBox::addFrame(const char *name, bool vertical, unsigned int style)
     frame->setLayout(groupLayout);
     groupLayout->setAlignment(LAYOUTS_ALIGNMENT);
     currentLayout->insertWidget(currentIndex++, frame);
+    indexLayout(frame, currentLayout);
 }
 
 void DialogBox::addTextBox(const char *title, const char *name,
@@ -222,17 +338,15 @@ void DialogBox::addTextBox(const char *title, const char *name,
     edit->setPlaceholderText(placeholder);
     edit->setEchoMode(password ? QLineEdit::Password : QLineEdit::Normal);
 
-    label->setObjectName(name);
+    registerWidget(label, name, TextBoxWidget);
+    indexType(edit, TextBoxWidget);
     label->setBuddy(edit);
     label->setFocusProxy(edit);
 
     box->addWidget(label);
     box->addWidget(edit);
 
-    if (groupLayout)
-        ((QBoxLayout *)groupLayout)->insertLayout(groupIndex++, box);
-    else
-        ((QBoxLayout *)currentLayout)->insertLayout(currentIndex++, box);
+    insertLayout(box);
 
     updateTabsOrder();
 }
@@ -244,7 +358,8 @@ void DialogBox::addListBox(const char *title, const char *name, bool activation,
     QLabel *label = new QLabel(title);
     ListBox *list = new ListBox;
 
-    label->setObjectName(QString(name));
+    registerWidget(label, name, ListBoxWidget);
+    indexType(list, ListBoxWidget);
     label->setBuddy(list);
     label->setFocusProxy(list);
 
@@ -254,10 +369,7 @@ void DialogBox::addListBox(const char *title, const char *name, bool activation,
     currentListWidget = currentView = list;
     viewIndex = 0;
 
-    if (groupLayout)
-        groupLayout->insertLayout(groupIndex++, box);
-    else
-        currentLayout->insertLayout(currentIndex++, box);
+    insertLayout(box);
 
     if (activation) {
         connect(list, SIGNAL(activated(const QModelIndex &)), this,
@@ -266,9 +378,8 @@ void DialogBox::addListBox(const char *title, const char *name, bool activation,
     }
 
     if (selection) {
-        connect(list,
-            SIGNAL(currentItemChanged(QListWidgetItem *, QListWidgetItem *)),
-            this, SLOT(listBoxItemSelected(QListWidgetItem *)));
+        connect(list, SIGNAL(currentItemChanged(const QModelIndex &)), this,
+                SLOT(listBoxItemSelected(const QModelIndex &)));
     }
 
     updateTabsOrder();
@@ -281,10 +392,13 @@ void DialogBox::addComboBox(const char *title, const char *name, bool editable,
     QLabel *label = new QLabel(title);
     QComboBox *list = new QComboBox;
 
-    label->setObjectName(QString(name));
+    registerWidget(label, name, ComboBoxWidget);
+    indexType(list, ComboBoxWidget);
     label->setBuddy(list);
     label->setFocusProxy(list);
 
+    list->setModel(new ListModel(list));
+    ((QListView *)list->view())->setUniformItemSizes(true);
     list->setEditable(editable);
 
     // Prevent insertions as there is no way to report them. Instead an apply
@@ -298,10 +412,7 @@ void DialogBox::addComboBox(const char *title, const char *name, bool editable,
     currentListWidget = list;
     viewIndex = 0;
 
-    if (groupLayout)
-        groupLayout->insertLayout(groupIndex++, box);
-    else
-        currentLayout->insertLayout(currentIndex++, box);
+    insertLayout(box);
 
     // Qt::QueuedConnection is used for this type widget to fix the bug when
     // the first added item made current and is reported as an emty one
@@ -323,30 +434,51 @@ void DialogBox::addItem(const char *title, const char *icon, bool current)
     // to use Qt::QueuedConnection for connections for objects of this type.
 
     if (currentView) {
-        QAbstractItemModel *model = currentView->model();
-
-        model->insertRows(viewIndex, 1);
-        model->setData(model->index(viewIndex, 0), QIcon(icon),
-                       Qt::DecorationRole);
-        model->setData(model->index(viewIndex, 0), QString(title),
-                       Qt::DisplayRole);
-        if (current || model->rowCount() == 1) {
-            if (widgetType(currentListWidget) == ComboBoxWidget)
-                ((QComboBox *)currentListWidget)->setCurrentIndex(viewIndex);
-            else
-                currentView->setCurrentIndex(model->index(viewIndex, 0));
-        }
+        ListModel *model = (ListModel *)currentView->model();
+
+        model->insertItem(viewIndex, QString(title),
+                          loadIcon(icon, currentView->iconSize()));
+        if (current || model->rowCount() == 1)
+            setCurrentItem(viewIndex);
         viewIndex++;
     }
 }
 
+/*******************************************************************************
+ *  addItems adds items given one per line either by the string or by the file
+ *  at once.
+ ******************************************************************************/
+void DialogBox::addItems(const char *items, bool file)
+{
+    if (currentView) {
+        ListModel *model = (ListModel *)currentView->model();
+        QByteArray lines;
+        int count;
+
+        if (file) {
+            QFile list(items);
+
+            if (!list.open(QFile::ReadOnly))
+                return;
+            lines = list.readAll();
+        } else {
+            lines = QByteArray::fromRawData(items, strlen(items));
+        }
+
+        count = model->insertItems(viewIndex, lines);
+        if (count && model->rowCount() == count)
+            setCurrentItem(viewIndex);
+        viewIndex += count;
+    }
+}
+
 void DialogBox::addSeparator(const char *name, bool vertical,
                              unsigned int style)
 {
     unsigned int shadow = QFrame::Sunken;
     QFrame *separator = new QFrame;
 
-    separator->setObjectName(name);
+    registerWidget(separator, name, SeparatorWidget);
 
     if (vertical) {
         separator->setFrameShape(QFrame::VLine);
@@ -368,17 +500,14 @@ void DialogBox::addSeparator(const char *name, bool vertical,
 
     separator->setFrameShadow(QFrame::Shadow(shadow));
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, separator);
-    else
-        currentLayout->insertWidget(currentIndex++, separator);
+    insertWidget(separator);
 }
 
 void DialogBox::addProgressBar(const char *name, bool vertical, bool busy)
 {
     QProgressBar *pb = new QProgressBar;
 
-    pb->setObjectName(QString(name));
+    registerWidget(pb, name, ProgressBarWidget);
 
     if (vertical) {
         pb->setOrientation(Qt::Vertical);
@@ -390,32 +519,28 @@ void DialogBox::addProgressBar(const char *name, bool vertical, bool busy)
     else
         pb->setRange(0, 100);
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, pb);
-    else
-        currentLayout->insertWidget(currentIndex++, pb);
+    insertWidget(pb);
 }
 
-void DialogBox::addSlider(const char *name, bool vertical, int min, int max)
+void DialogBox::addSlider(const char *name, bool vertical, int min, int max,
+                          bool debounce)
 {
-    QSlider *slider = new QSlider;
+    Slider *slider = new Slider;
 
-    slider->setObjectName(QString(name));
+    registerWidget(slider, name, SliderWidget);
     if (!vertical)
         slider->setOrientation(Qt::Horizontal);
     slider->setTickPosition(QSlider::TicksAbove);
-    slider->setTracking(false);
-    connect(slider, SIGNAL(valueChanged(int)), this,
+    if (debounce)
+        slider->setDebounceInterval(DEBOUNCE_INTERVAL);
+    connect(slider, SIGNAL(valueReported(int)), this,
             SLOT(sliderValueChanged(int)));
     connect(slider, SIGNAL(rangeChanged(int, int)), this,
             SLOT(sliderRangeChanged(int, int)));
 
     slider->setRange(min, max);
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, slider);
-    else
-        currentLayout->insertWidget(currentIndex++, slider);
+    insertWidget(slider);
 
     updateTabsOrder();
 }
@@ -423,12 +548,11 @@ void DialogBox::addSlider(const char *name, bool vertical, int min, int max)
 void DialogBox::addTextView(const char *name, const char *file)
 {
     QTextEdit *viewer = new QTextEdit;
-    QFile txt(file);
 
-    viewer->setObjectName(QString(name));
+    registerWidget(viewer, name, TextViewWidget);
     viewer->setReadOnly(true);
-    if (txt.open(QFile::ReadOnly))
-        viewer->setText(QTextStream(&txt).readAll());
+    viewer->setUndoRedoEnabled(false);  // Don't keep a copy of loaded text
+    loadText(viewer, file);
 
     // Below includes TextSelectableByMouse | LinksAccessibleByMouse
     // | LinksAccessibleByKeyboard.
@@ -437,10 +561,7 @@ void DialogBox::addTextView(const char *name, const char *file)
     // inconvenient.
     viewer->setTextInteractionFlags(Qt::TextBrowserInteraction);
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, viewer);
-    else
-        currentLayout->insertWidget(currentIndex++, viewer);
+    insertWidget(viewer);
 
     updateTabsOrder();
 }
@@ -449,7 +570,7 @@ void DialogBox::addTabs(const char *name, unsigned int position)
 {
     QTabWidget *tabs = new QTabWidget;
 
-    tabs->setObjectName(QString(name));
+    registerWidget(tabs, name, TabsWidget);
 
     position &= PropertyMask;
     // Reset this bit instead of masking another 4 bits
@@ -466,10 +587,7 @@ void DialogBox::addTabs(const char *name, unsigned int position)
     currentTabsWidget = tabs;
     tabsIndex = 0;
 
-    if (groupLayout)
-        groupLayout->insertWidget(groupIndex++, tabs);
-    else
-        currentLayout->insertWidget(currentIndex++, tabs);
+    insertWidget(tabs);
 
     updateTabsOrder();
 }
@@ -482,7 +600,7 @@ void DialogBox::addPage(const char *title, const char *name, const char *icon,
 
         QWidget *page = new QWidget;
 
-        page->setObjectName(QString(name));
+        registerWidget(page, name, PageWidget);
 
         QVBoxLayout *ml = new QVBoxLayout;
         QHBoxLayout *hl = new QHBoxLayout;
@@ -502,7 +620,9 @@ void DialogBox::addPage(const char *title, const char *name, const char *icon,
         connect(page, SIGNAL(destroyed(QObject *)), this,
                 SLOT(removePage(QObject *)));
 
-        currentTabsWidget->insertTab(tabsIndex, page, QIcon(icon),
+        currentTabsWidget->insertTab(tabsIndex, page,
+                                     loadIcon(icon,
+                                              currentTabsWidget->iconSize()),
                                      QString(title));
         if (current)
             currentTabsWidget->setCurrentIndex(tabsIndex);
@@ -653,6 +773,89 @@ void DialogBox::stepVertical()
     sanitizeLayout(oldLayout);
 }
 
+/*******************************************************************************
+ *  beginTransaction suspends updates of the dialog box until the matching
+ *  commitTransaction call. Focus order updates and layouts sanitizing are
+ *  deferred as well. Transactions can be nested.
+ ******************************************************************************/
+void DialogBox::beginTransaction()
+{
+    if (!transactionDepth++) {
+        transactionTimer.start();
+        setUpdatesEnabled(false);
+    }
+}
+
+/*******************************************************************************
+ *  commitTransaction applies changes made within the outermost transaction
+ *  with a single layout activation and a single repaint.
+ ******************************************************************************/
+void DialogBox::commitTransaction()
+{
+    if (!transactionDepth || --transactionDepth)
+        return;
+
+    QList<QPointer<QLayout> > layouts;
+
+    layouts.swap(pendingLayouts);
+    for (int i = 0, j = layouts.count(); i < j; i++) {
+        // Might be deleted either by a former command or by sanitizing
+        if (layouts.at(i))
+            sanitizeLayout(layouts.at(i));
+    }
+
+    applyTabsOrder();
+    layout()->activate();
+    setUpdatesEnabled(true);
+
+    transactionsCount++;
+    transactionTime = transactionTimer.nsecsElapsed() / 1000;
+}
+
+/*******************************************************************************
+ *  append adds the line of text to the end of the textview or text label.
+ *  The textview document isn't reset so only the new line is laid out. With
+ *  scroll set the textview is scrolled to the end. Label of other content type
+ *  is changed to text one.
+ ******************************************************************************/
+void DialogBox::append(char *name, const char *text, bool scroll)
+{
+    QWidget *widget;
+
+    if ( !(widget = findWidget(name)) )
+        return;
+
+    switch ((unsigned)widgetType(widget)) {
+    case TextViewWidget: {
+        QTextCursor cursor(((QTextEdit *)widget)->document());
+        QString line = QString(text) + QChar('\n');
+
+        // Documents ending with a line break have an empty last block
+        cursor.movePosition(QTextCursor::End);
+        if (!cursor.atBlockStart())
+            line.prepend(QChar('\n'));
+        appendText(widget, line, scroll);
+        break;
+    }
+    case LabelWidget: {
+        QLabel *label = (QLabel *)widget;
+
+        if (label->movie() || picturesIndex.contains(label)) {
+            sanitizeLabel(label, TextContent);
+            label->setText(text);
+        } else if (label->text().isEmpty()) {
+            label->setText(text);
+        } else {
+            label->setText(label->text()
+                           + (Qt::mightBeRichText(label->text()) ? "<br>"
+                                                                 : "\n")
+                           + QString(text));
+        }
+        break;
+    }
+    }
+}
+
 void DialogBox::clear(char *name)
 {
     QWidget *widget;
@@ -1080,16 +1283,8 @@ QWidget *DialogBox::findWidget(char *name)
         }
 
         if (name[0])
-            for (int i = 0, j = pages.count(); i < j; i++) {
-                widget = pages.at(i);
-                if (!strcmp(widget->objectName().toLocal8Bit().constData(),
-                            name)) {
-                    // The widget is page
-                    break;
-                }
-                if ( (widget = findWidgetRecursively(widget->layout(), name)) )
-                    break;
-            }
+            widget = namesIndex.value(QByteArray::fromRawData(name,
+                                                              strlen(name)));
 
         switch ((unsigned)widgetType(widget)) {
         case ListBoxWidget:
@@ -1107,22 +1302,11 @@ QWidget *DialogBox::findWidget(char *name)
                 chosenRowFlag = true;
             }
             if (li_name) {
-                QAbstractItemModel *model = chosenView->model();
-                int i;
-                int j;
-                for (i = 0, j = model->rowCount(); i < j; i++) {
-                    if (!strcmp(model->data(model->index(i, 0), Qt::DisplayRole)
-                                .toString().toLocal8Bit().constData(),
-                                li_name)) {
-                        chosenRow = i;
-                        chosenRowFlag = true;
-                        break;
-                    }
-                }
-                if (i == j) {
-                    chosenRow = i;
-                    chosenRowFlag = true;
-                }
+                ListModel *model = (ListModel *)chosenView->model();
+
+                if ((chosenRow = model->findItem(li_name)) < 0)
+                    chosenRow = model->rowCount();
+                chosenRowFlag = true;
             }
         }
     }
@@ -1135,19 +1319,57 @@ QWidget *DialogBox::findWidget(char *name)
  ******************************************************************************/
 QLayout *DialogBox::findLayout(QWidget *widget)
 {
-    QLayout *layout = nullptr;
-    QWidget *page;
+    // Pages are not laid on layouts and are not indexed
+    return layoutsIndex.value(widget);
+}
+
+/*******************************************************************************
+ *  checkLayoutsIndex verifies the layouts index matches the layouts tree.
+ *  Returns false and reports the first mismatch found. Is intended for debug
+ *  builds.
+ ******************************************************************************/
+bool DialogBox::checkLayoutsIndex()
+{
+    int count = 0;
 
     for (int i = 0, j = pages.count(); i < j; i++) {
-        if ( (page = pages.at(i)) == widget ) {
-            // The widget is page
-            break;
+        if (!checkLayoutsRecursively(pages.at(i)->layout(), count))
+            return false;
+    }
+
+    if (count != layoutsIndex.count()) {
+        qWarning("Layouts index has %d records for %d widgets",
+                 layoutsIndex.count(), count);
+        return false;
+    }
+
+    return true;
+}
+
+bool DialogBox::checkLayoutsRecursively(QLayout *layout, int &count)
+{
+    for (int i = 0, j = layout->count(); i < j; i++) {
+        QLayoutItem *item = layout->itemAt(i);
+        QWidget *widget;
+        QLayout *child;
+
+        if ((widget = item->widget())) {
+            if (layoutsIndex.value(widget) != layout) {
+                qWarning("Layouts index mismatch for widget %s",
+                         widget->objectName().toLocal8Bit().constData());
+                return false;
+            }
+            count++;
+            child = widget->layout();
+        } else {
+            child = item->layout();
         }
-        if ( (layout = findLayoutRecursively(page->layout(), widget)) )
-            break;
+
+        if (child && !checkLayoutsRecursively(child, count))
+            return false;
     }
 
-    return layout;
+    return true;
 }
 
 /*******************************************************************************
@@ -1179,76 +1401,20 @@ void DialogBox::unholdDefaultPushButton()
  ******************************************************************************/
 DialogCommandTokens::Control DialogBox::widgetType(QWidget *widget)
 {
-    if (widget) {
-        const char *name = widget->metaObject()->className();
-
-        if (!strcmp(name, "DialogBox"))
-            return DialogWidget;
-        if (!strcmp(name, "QPushButton"))
-            return PushButtonWidget;
-        if (!strcmp(name, "QRadioButton"))
-            return RadioButtonWidget;
-        if (!strcmp(name, "QCheckBox"))
-            return CheckBoxWidget;
-        if (!strcmp(name, "QLabel")) {
-            if (QWidget *proxywidget = widget->focusProxy()) {
-                const char *proxyname = proxywidget->metaObject()->className();
-
-                if (!strcmp(proxyname, "QLineEdit"))
-                    return TextBoxWidget;
-                if (!strcmp(proxyname, "QComboBox")) {
-                    if (chosenRowFlag)
-                        return ItemWidget;
-                    return ComboBoxWidget;
-                }
-                if (!strcmp(proxyname, "ListBox")) {
-                    if (chosenRowFlag)
-                        return ItemWidget;
-                    return ListBoxWidget;
-                }
-            }
-            return LabelWidget;
-        }
-        if (!strcmp(name, "QGroupBox"))
-            return GroupBoxWidget;
-        if (!strcmp(name, "QFrame")) {
-            int shape = ((QFrame *)widget)->frameStyle() & QFrame::Shape_Mask;
-
-            if (shape == QFrame::HLine || shape == QFrame::VLine)
-                return SeparatorWidget;
-            return FrameWidget;
-        }
-        if (!strcmp(name, "QLineEdit")) {
-            // If the object queried directly
-            return TextBoxWidget;
-        }
-        if (!strcmp(name, "ListBox")) {
-            // If the object queried directly
-            if (chosenRowFlag)
-                return ItemWidget;
-            return ListBoxWidget;
-        }
-        if (!strcmp(name, "QComboBox")) {
-            // If the object queried directly
-            if (chosenRowFlag)
-                return ItemWidget;
-            return ComboBoxWidget;
-        }
+    if (widget == this)
+        return DialogWidget;
+
+    Control type = typesIndex.value(widget, NoneWidget);
 
-        if (!strcmp(name, "QTabWidget"))
-            return TabsWidget;
-        if (!strcmp(name, "QWidget"))
-            return PageWidget;
-
-        if (!strcmp(name, "QProgressBar"))
-            return ProgressBarWidget;
-        if (!strcmp(name, "QSlider"))
-            return SliderWidget;
-        if (!strcmp(name, "QTextEdit"))
-            return TextViewWidget;
+    switch ((unsigned)type) {
+    case ListBoxWidget:
+    case ComboBoxWidget:
+        if (chosenRowFlag)
+            return ItemWidget;
+        break;
     }
 
-    return NoneWidget;
+    return type;
 }
 
 /*******************************************************************************
@@ -1259,6 +1425,20 @@ DialogCommandTokens::Control DialogBox::widgetType(QWidget *widget)
  *
  ******************************************************************************/
 
+ListBox::ListBox()
+{
+    setModel(new ListModel(this));
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setUniformItemSizes(true);
+}
+
+void ListBox::currentChanged(const QModelIndex &current,
+                             const QModelIndex &previous)
+{
+    QListView::currentChanged(current, previous);
+    emit currentItemChanged(current);
+}
+
 void ListBox::focusInEvent(QFocusEvent *event)
 {
     if (activateFlag) {
@@ -1266,7 +1446,7 @@ void ListBox::focusInEvent(QFocusEvent *event)
         if (dialog)
             dialog->holdDefaultPushButton();
     }
-    QListWidget::focusInEvent(event);
+    QListView::focusInEvent(event);
 }
 
 void ListBox::focusOutEvent(QFocusEvent *event)
@@ -1276,7 +1456,7 @@ void ListBox::focusOutEvent(QFocusEvent *event)
         if (dialog)
             dialog->unholdDefaultPushButton();
     }
-    QListWidget::focusOutEvent(event);
+    QListView::focusOutEvent(event);
 }
 
 void ListBox::setActivateFlag(bool flag)
@@ -1295,45 +1475,157 @@ void ListBox::setActivateFlag(bool flag)
 
 /*******************************************************************************
  *
- *  NON-CLASS MEMBER FUNCTIONS
+ *  Slider class reports value changes either immediately or, if debounce
+ *  interval is set, once the value stays unchanged for the interval.
  *
  ******************************************************************************/
 
-QWidget *findWidgetRecursively(QLayoutItem *item, const char *name)
+Slider::Slider()
 {
-    QLayout *layout;
-    QWidget *widget;
+    debounceTimer.setSingleShot(true);
+    connect(this, SIGNAL(valueChanged(int)), this, SLOT(changeValue(int)));
+    connect(&debounceTimer, SIGNAL(timeout()), this, SLOT(reportValue()));
+}
 
-    if ((layout = item->layout())) {
-        for (int i = 0, j = layout->count(); i < j; i++)
-            if ((widget = findWidgetRecursively(layout->itemAt(i), name)))
-                return widget;
-    } else if ((widget = item->widget())) {
-        if (!strcmp(widget->objectName().toLocal8Bit().constData(), name))
-            return widget;
-        if ((layout = widget->layout()))
-            return findWidgetRecursively(layout, name);
+/*******************************************************************************
+ *  Zero interval makes the slider report each change.
+ ******************************************************************************/
+void Slider::setDebounceInterval(int msec)
+{
+    debounceTimer.setInterval(msec > 0 ? msec : 0);
+    if (debounceTimer.isActive() && !debounceTimer.interval()) {
+        debounceTimer.stop();
+        reportValue();
     }
-    return nullptr;
 }
 
-QLayout *findLayoutRecursively(QLayout *layout, QWidget *widget)
+void Slider::changeValue(int value)
 {
-    if (widget && layout) {
-        for (int i = 0, j = layout->count(); i < j; i++) {
-            QLayoutItem *item = layout->itemAt(i);
-            QWidget *w = item->widget();
-            QLayout *retlayout;
+    if (debounceTimer.interval())
+        debounceTimer.start();
+    else
+        emit valueReported(value);
+}
 
-            if (w == widget) {
-                return layout;
-            } else {
-                retlayout = findLayoutRecursively(w ? w->layout()
-                                                  : item->layout(), widget);
-                if (retlayout)
-                    return retlayout;
-            }
-        }
+void Slider::reportValue()
+{
+    emit valueReported(value());
+}
+
+/*******************************************************************************
+ *  PictureLoader constructor
+ ******************************************************************************/
+PictureLoader::PictureLoader(QObject *receiver, int id, const QString &file,
+                             const QSize &size,
+                             QSharedPointer<QAtomicInt> cancelled):
+    receiver(receiver),
+    id(id),
+    file(file),
+    size(size),
+    cancelled(cancelled)
+{
+}
+
+/*******************************************************************************
+ *  Decodes the picture. The cancelled flag is checked before the decoding
+ *  starts and before the result is delivered as QImageReader can't be
+ *  interrupted.
+ ******************************************************************************/
+void PictureLoader::run()
+{
+    if (*cancelled)
+        return;
+
+    QImageReader reader(file);
+    QSize scaledSize = fitSize(reader.size(), size);
+
+    // Decoders of some formats (e.g. JPEG) scale while decoding
+    if (scaledSize.isValid())
+        reader.setScaledSize(scaledSize);
+
+    QImage image = reader.read();
+
+    if (*cancelled)
+        return;
+
+    QMetaObject::invokeMethod(receiver, "pictureLoaded", Qt::QueuedConnection,
+                              Q_ARG(int, id), Q_ARG(QImage, image));
+}
+
+/*******************************************************************************
+ *  fitSize returns the image size scaled down to fit into the given size
+ *  keeping its aspect ratio. Invalid size is returned if the image isn't to be
+ *  scaled: either of the sizes is invalid or the image fits as is.
+ ******************************************************************************/
+QSize PictureLoader::fitSize(const QSize &imageSize, const QSize &size)
+{
+    if (!imageSize.isValid() || !size.isValid()
+        || (imageSize.width() <= size.width()
+            && imageSize.height() <= size.height()))
+        return QSize();
+
+    return imageSize.scaled(size, Qt::KeepAspectRatio);
+}
+
+/*******************************************************************************
+ *  TextLoader constructor
+ ******************************************************************************/
+TextLoader::TextLoader(QObject *receiver, int id, const QString &file,
+                       QSharedPointer<QAtomicInt> cancelled,
+                       QSharedPointer<QSemaphore> chunks):
+    receiver(receiver),
+    id(id),
+    file(file),
+    cancelled(cancelled),
+    chunks(chunks)
+{
+}
+
+/*******************************************************************************
+ *  Reads the text file by chunks. Rich text can't be laid out by parts so it
+ *  is delivered as a whole. It is detected by the first chunk the same way
+ *  QTextEdit::setText does. A file which can't be opened is delivered as a
+ *  single empty chunk, so the receiver always sees the load completed.
+ *  Each chunk is delivered along with the number of bytes read so far.
+ ******************************************************************************/
+void TextLoader::run()
+{
+    QFile txt(file);
+
+    if (*cancelled)
+        return;
+
+    if (!txt.open(QFile::ReadOnly)) {
+        QMetaObject::invokeMethod(receiver, "textLoaded", Qt::QueuedConnection,
+                                  Q_ARG(int, id), Q_ARG(QString, QString()),
+                                  Q_ARG(bool, true), Q_ARG(bool, true),
+                                  Q_ARG(qint64, 0));
+        return;
     }
-    return nullptr;
+
+    QTextStream stream(&txt);
+    bool first = true;
+    bool last;
+
+    do {
+        QString text = stream.read(TEXT_CHUNK_SIZE);
+
+        if (first && Qt::mightBeRichText(text))
+            text += stream.readAll();
+        last = stream.atEnd();
+
+        // Wait until the receiver appends one of the chunks delivered before
+        while (!chunks->tryAcquire(1, 100)) {
+            if (*cancelled)
+                return;
+        }
+        if (*cancelled)
+            return;
+
+        QMetaObject::invokeMethod(receiver, "textLoaded", Qt::QueuedConnection,
+                                  Q_ARG(int, id), Q_ARG(QString, text),
+                                  Q_ARG(bool, first), Q_ARG(bool, last),
+                                  Q_ARG(qint64, txt.pos()));
+        first = false;
+    } while (!last);
 }
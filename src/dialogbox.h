@@ -37,6 +37,15 @@
 #define LAYOUTS_ALIGNMENT WIDGETS_ALIGNMENT
 
 #define BUFFER_SIZE 1024
+#define INPUT_BUFFER_SIZE 65536
+#define OUTPUT_BUFFER_SIZE 65536
+#define COMMAND_QUEUE_SIZE 1024
+#define DEBOUNCE_INTERVAL 200  // Default slider debounce interval in ms
+#define PIXMAP_CACHE_SIZE 10240  // Default pixmap cache limit in KB
+#define ICONS_CACHE_SIZE 256  // Maximum number of cached icons
+#define TEXT_CHUNK_SIZE 65536  // Characters appended to textview at once
+#define TEXT_CHUNKS_PENDING 4  // Chunks delivered but not appended yet
+#define FOLLOW_LINES 10000  // Default lines limit of followed textview
 
 namespace DialogCommandTokens
 {
@@ -55,6 +64,9 @@ namespace DialogCommandTokens
         ClearCommand =    0x00004000,
         PositionCommand = 0x00008000,
         QueryCommand =    0x00010000,
+        BeginCommand =    0x00020000,
+        CommitCommand =   0x00040000,
+        AppendCommand =   0x00080000,
         PrintCommand =    0x80000000,
 
         // Masks
@@ -72,7 +84,9 @@ namespace DialogCommandTokens
         OptionBehind =     PositionCommand | 0x00000001,
         OptionOnto =       PositionCommand | 0x00000002,
         OptionSpace =      AddCommand | 0x00000001,
-        OptionStretch =    AddCommand | 0x00000002
+        OptionStretch =    AddCommand | 0x00000002,
+        OptionStatistics = QueryCommand | 0x00000001,
+        OptionScroll =     AppendCommand | 0x00000001
     };
 
     enum Control {
@@ -107,6 +121,7 @@ namespace DialogCommandTokens
         // Properties specific for particular widget types
         PropertyTitle = CaptionWidgetsMask | 0x00000001,
         PropertyText = CaptionWidgetsMask | 0x00000002,
+        PropertyCacheSize = DialogWidget | 0x00000008,
         PropertyIcon = DialogWidget | ItemWidget | PageWidget | PushButtonWidget
                        | RadioButtonWidget | CheckBoxWidget | 0x00000004,
         PropertyChecked = GroupBoxWidget | PushButtonWidget | RadioButtonWidget
@@ -126,6 +141,7 @@ namespace DialogCommandTokens
         PropertyPlaceholder = TextBoxWidget | 0x00000008,
         PropertyPicture = LabelWidget | 0x00000004,
         PropertyAnimation = LabelWidget | 0x00000008,
+        PropertySize = LabelWidget | 0x00000010,
         PropertyPlain = FrameWidget | SeparatorWidget | 0x00000010,
         PropertyRaised = FrameWidget | SeparatorWidget | 0x00000020,
         PropertySunken = FrameWidget | SeparatorWidget | 0x00000040,
@@ -134,6 +150,8 @@ namespace DialogCommandTokens
         PropertyPanel = FrameWidget | 0x00000004,
         PropertyStyled = FrameWidget | 0x00000008,
         PropertyCurrent = ItemWidget | PageWidget | 0x00000008,
+        PropertyItems = ItemWidget | 0x00000010,
+        PropertyItemsFile = ItemWidget | 0x00000020,
         PropertyEditable = ComboBoxWidget | 0x00000004,
         PropertySelection = ComboBoxWidget | ListBoxWidget | 0x00000008,
         PropertyActivation = ListBoxWidget | 0x00000004,
@@ -141,7 +159,10 @@ namespace DialogCommandTokens
         PropertyMaximum = ProgressBarWidget | SliderWidget | 0x00000002,
         PropertyValue = ProgressBarWidget | SliderWidget | 0x00000004,
         PropertyBusy = ProgressBarWidget | 0x00000008,
+        PropertyTracking = SliderWidget | 0x00000010,
+        PropertyDebounce = SliderWidget | 0x00000020,
         PropertyFile = TextViewWidget | 0x00000004,
+        PropertyFollow = TextViewWidget | 0x00000008,
         PropertyPositionTop = TabsWidget | 0x00000001,
         PropertyPositionBottom = TabsWidget | 0x00000002,
         PropertyPositionLeft = TabsWidget | 0x00000004,
@@ -152,30 +173,36 @@ namespace DialogCommandTokens
 
 struct DialogCommand
 {
-    DialogCommand()
+    DialogCommand() :
+        buffer(1, '\0'),
+        title(0),
+        name(0),
+        text(0),
+        auxtext(0)
     {
-        buffer[BUFFER_SIZE - 1] = '\0';
-        title = name = text = auxtext = BUFFER_SIZE - 1;
     }
 
     char *getTitle()
     {
-        return buffer + title;
+        return buffer.data() + title;
     }
     char *getName()
     {
-        return buffer + name;
+        return buffer.data() + name;
     }
     char *getText()
     {
-        return buffer + text;
+        return buffer.data() + text;
     }
     char *getAuxText()
     {
-        return buffer + auxtext;
+        return buffer.data() + auxtext;
     }
 
-    char buffer[BUFFER_SIZE];
+    // Custom strings of the command are stored one after another and are
+    // referred by their offsets. The buffer starts with the empty string which
+    // is referred by the strings omitted.
+    QByteArray buffer;
     size_t title;
     size_t name;
     size_t text;
@@ -196,8 +223,34 @@ public:
         MovieContent,
     };
 
+    // Properties resolved by widgetProperty. Must match propertyNames array.
+    enum WidgetProperty {
+        DefaultProperty,
+        CheckedProperty,
+        CheckableProperty,
+        EchoModeProperty,
+        PlaceholderTextProperty,
+        TextProperty,
+        TitleProperty,
+        WindowTitleProperty,
+        PixmapProperty,
+        IconProperty,
+        WindowIconProperty,
+        IconSizeProperty,
+        FrameShadowProperty,
+        FrameShapeProperty,
+        MinimumProperty,
+        MaximumProperty,
+        ValueProperty,
+        TabPositionProperty,
+
+        PropertiesCount
+    };
+
     DialogBox(const char *title, const char *about = nullptr,
-              bool resizable = false, FILE *out = stdout);
+              bool resizable = false, FILE *out = stdout,
+              bool buffered = true);
+    ~DialogBox();
 
     void addPushButton(const char *title, const char *name, bool apply = false,
                        bool exit = false, bool def = false);
@@ -208,7 +261,8 @@ public:
                     const char *text = nullptr,
                     const char *placeholder = nullptr, bool password = false);
     void addLabel(const char *title, const char *name = nullptr,
-                  enum ContentType content = TextContent);
+                  enum ContentType content = TextContent,
+                  const QSize &size = QSize());
     void addGroupBox(const char *title, const char *name, bool vertical = true,
                      bool checkable = false, bool checked = false);
     void addFrame(const char *name, bool vertical = true,
@@ -225,6 +279,7 @@ public:
                      bool selection = false);
     void addItem(const char *title, const char *icon = nullptr,
                  bool current = false);
+    void addItems(const char *items, bool file = false);
 
     void endList()
     {
@@ -253,7 +308,7 @@ public:
     void addProgressBar(const char *name, bool vertical = false,
                         bool busy = false);
     void addSlider(const char *name, bool vertical = false, int min = 0,
-                   int max = 100);
+                   int max = 100, bool debounce = false);
     void addTextView(const char *name, const char *file = nullptr);
     void addTabs(const char *name, unsigned int position = 0);
     void addPage(const char *title, const char *name,
@@ -264,6 +319,9 @@ public:
     void stepHorizontal();
     void stepVertical();
 
+    void beginTransaction();
+    void commitTransaction();
+
     void clear(char *name);
     void clearChosenList();  // Clears the list chosen by findWidget()
     void clearTabs(QTabWidget *);
@@ -272,6 +330,7 @@ public:
 
     void removeWidget(char *name);
     void position(char *name, bool behind = false, bool onto = false);
+    void append(char *name, const char *text, bool scroll = false);
 
     void setEnabled(QWidget *widget, bool enable);
     void setOptions(QWidget *widget, unsigned int options, unsigned int mask,
@@ -290,8 +349,13 @@ public:
     void holdDefaultPushButton();
     void unholdDefaultPushButton();
 
+    void executeCommand(DialogCommand &);
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event) final;
+
 public slots:
-    void executeCommand(DialogCommand);
+    void queueCommand(const DialogCommand &);
     void report();
     void done(int);
 
@@ -299,16 +363,31 @@ private slots:
     void pushButtonClicked();
     void pushButtonToggled(bool);
     void listBoxItemActivated(const QModelIndex &);
-    void listBoxItemSelected(QListWidgetItem *);
+    void listBoxItemSelected(const QModelIndex &);
     void comboBoxItemSelected(int);
     void sliderValueChanged(int);
     void sliderRangeChanged(int, int);
     void removePage(QObject *);
+    void unregisterWidget(QObject *);
+    void executeCommands();
+    void writeOutput();
+    void pictureLoaded(int id, const QImage &image);
+    void textLoaded(int id, const QString &text, bool first, bool last,
+                    qint64 size);
+    void followedFileChanged(const QString &file);
+    void followedDirectoryChanged(const QString &dir);
 
 private:
     QPushButton *defaultPushButton;
 
     QList<QWidget *> pages;
+    QHash<QByteArray, QWidget *> namesIndex;  // Named widgets by their names
+    QSet<QByteArray> duplicateNames;  // Names given to more than one widget
+    QHash<QObject *, QLayout *> layoutsIndex;  // Layouts widgets are laid on
+    QHash<QObject *, DialogCommandTokens::Control> typesIndex;  // Widgets types
+    QSet<QObject *> tabsOrderPages;  // Pages pending focus order update
+    // Property handles by widget classes
+    QHash<const QMetaObject *, QVector<QMetaProperty> > propertiesIndex;
 
     QBoxLayout *currentLayout;
     int currentIndex;
@@ -331,10 +410,91 @@ private:
     int tabsIndex;
 
     FILE *output;
+    bool outputBuffered;
+    bool flushPending;  // writeOutput is scheduled
 
     bool empty;
 
+    // Commands received from the parser thread and not executed yet
+    QList<DialogCommand> commandQueue;
+    QMutex queueMutex;
+    QWaitCondition queueDrained;
+    bool executing;
+    bool eventsPending;  // Show, hide or stylesheet events aren't processed
+    unsigned long coalescedCommands;  // Superseded by queueCommand
+
+    int transactionDepth;  // Nesting level of begin commands
+    QElapsedTimer transactionTimer;
+    QList<QPointer<QLayout> > pendingLayouts;  // To sanitize on commit
+    unsigned long transactionsCount;
+    qint64 transactionTime;  // Time of the last transaction in microseconds
+
+    QCache<QString, QIcon> iconsCache;  // Pixmaps are in QPixmapCache
+    unsigned long pixmapHits;
+    unsigned long pixmapMisses;
+    unsigned long iconHits;
+    unsigned long iconMisses;
+
+    struct PictureLoad
+    {
+        QPointer<QWidget> label;  // The picture is for
+        QString key;  // Pixmap cache key
+        QSharedPointer<QAtomicInt> cancelled;  // Shared with PictureLoader
+    };
+    QHash<QObject *, QString> picturesIndex;  // Files of picture labels
+    QHash<QObject *, QSize> sizesIndex;  // Sizes labels fit pictures into
+    QHash<int, PictureLoad> pictureLoads;  // Pictures being decoded by ids
+    int pictureLoadId;  // Id of the last started load
+
+    struct TextLoad
+    {
+        QPointer<QWidget> viewer;  // The text is for
+        QSharedPointer<QAtomicInt> cancelled;  // Shared with TextLoader
+        QSharedPointer<QSemaphore> chunks;  // Chunks TextLoader may deliver
+    };
+    QHash<int, TextLoad> textLoads;  // Text files being read by ids
+    int textLoadId;  // Id of the last started load
+
+    struct TextFile
+    {
+        QString name;
+        qint64 size;  // Bytes displayed, -1 while the file is being loaded
+        bool follow;  // Appended bytes are displayed
+    };
+    QHash<QObject *, TextFile> textFilesIndex;  // Files of textviews
+    QFileSystemWatcher filesWatcher;  // Watches followed files or their dirs
+
+    QThreadPool loadersPool;  // Decodes pictures and reads text files
+
+    void registerWidget(QWidget *widget, const char *name,
+                        DialogCommandTokens::Control type);
+    void indexType(QWidget *widget, DialogCommandTokens::Control type);
+    void indexLayout(QWidget *widget, QLayout *layout);
+    void insertWidget(QWidget *widget);
+    void insertLayout(QBoxLayout *layout);
+    bool checkLayoutsIndex();
+    bool checkLayoutsRecursively(QLayout *layout, int &count);
     void updateTabsOrder(QWidget *page = nullptr);
+    void applyTabsOrder();
+    void setTabsOrder(QWidget *page);
+    QMetaProperty widgetProperty(QWidget *widget, enum WidgetProperty property);
+    void flushOutput();
+    void setCurrentItem(int row);
+    void processPendingEvents();
+    void printStatistics();
+    QString pixmapKey(const QString &file, const QSize &size);
+    void loadPicture(QWidget *label, const QString &file);
+    void cancelPictureLoad(QWidget *label);
+    void loadMovie(QWidget *label, const QString &file);
+    void setLabelSize(QWidget *label, const QSize &size);
+    void loadText(QWidget *viewer, const QString &file);
+    void cancelTextLoad(QWidget *viewer);
+    void setFollow(QWidget *viewer, bool follow, int lines);
+    void updateFilesWatcher();
+    void readAppendedText(QWidget *viewer);
+    void appendText(QWidget *viewer, const QString &text, bool scroll);
+    static QSize parseSize(const char *text);
+    QIcon loadIcon(const char *file, const QSize &size = QSize());
     void sanitizeLabel(QWidget *label, enum ContentType content);
 
     bool removeIfEmpty(QLayout *);
@@ -350,49 +510,73 @@ class DialogParser : public QThread, private DialogCommand
     Q_OBJECT
 
 public:
+    enum Stage {
+        StageCommand = 0x00000001,
+        StageType =    0x00000002,
+        StageTitle =   0x00000004,
+        StageName =    0x00000008,
+        StageText =    0x00000010,
+        StageAuxText = 0x00000020,
+        StageOptions = 0x00000040
+    };
+
     DialogParser(DialogBox *parent = 0, FILE *in = stdin);
     ~DialogParser();
 
     void setParent(DialogBox *parent);
 
 signals:
-    void sendCommand(DialogCommand);
+    void sendCommand(const DialogCommand &);
 
 protected:
     virtual void run();
 
 private:
-    enum Stage {
-        StageCommand = 0x00000001,
-        StageType =    0x00000002,
-        StageTitle =   0x00000004,
-        StageName =    0x00000008,
-        StageText =    0x00000010,
-        StageAuxText = 0x00000020,
-        StageOptions = 0x00000040
-    };
-
     void processToken();
     void issueCommand();
+    bool fillInput();
+    void waitForInput();
+
+    // Input is read by blocks and the characters are fetched from the buffer
+    // to avoid stdio locking and call overhead per character.
+    int readChar()
+    {
+        if (inputIndex == inputSize && !fillInput())
+            return EOF;
+        return (unsigned char)inputBuffer[inputIndex++];
+    }
+
+    // Grows the command buffer to hold at least the given number of bytes
+    void reserveBuffer(size_t size)
+    {
+        if (size > (size_t)buffer.size())
+            buffer.resize(qMax(size, (size_t)buffer.size() * 2));
+    }
 
     DialogBox *dialog;
     FILE *input;
+    int descriptor;
     unsigned int stage;
     size_t token;
     size_t bufferIndex;
+
+    char inputBuffer[INPUT_BUFFER_SIZE];
+    size_t inputIndex;
+    size_t inputSize;
 };
 
-//  Below class is the workaround to address QListWidget limitation:
+//  Below class is the workaround to address QListView limitation:
 //    the widget reports current item as "activated" (emits the signal) on the
 //    Enter key press event but propagates this event to next widgets.
 //    The default/autodefault pushbutton might respond to it even by closing
 //    the dialog.
-class ListBox : public QListWidget
+//  It also reports current item changes by a single signal.
+class ListBox : public QListView
 {
     Q_OBJECT
 
 public:
-    ListBox() = default;
+    ListBox();
 
     void setActivateFlag(bool flag);
     bool getActivateFlag()
@@ -400,16 +584,129 @@ public:
         return activateFlag;
     };
 
+signals:
+    void currentItemChanged(const QModelIndex &);
+
 protected:
     void focusInEvent(QFocusEvent *event) final;
     void focusOutEvent(QFocusEvent *event) final;
+    void currentChanged(const QModelIndex &current,
+                       const QModelIndex &previous) final;
 
 private:
     bool activateFlag = false;
 };
 
-//  NON-CLASS MEMBERS
-QWidget *findWidgetRecursively(QLayoutItem *item, const char *name);
-QLayout *findLayoutRecursively(QLayout *layout, QWidget *widget);
+//  Model of listbox and combobox widgets. It is a flat list of text items with
+//  optional icons. Texts are kept in a single UTF-8 buffer and icons in a
+//  single vector, rows refer to them by offsets. Replaced and removed entries
+//  are reclaimed once they take more than half of the storage.
+//  Rows are indexed by hashes of their texts for lookups by text. Appending,
+//  text changes and removals update the index, insertions above the last row
+//  make it rebuilt on the next lookup.
+class ListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit ListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const final;
+    QVariant data(const QModelIndex &index, int role) const final;
+    bool setData(const QModelIndex &index, const QVariant &value,
+                 int role = Qt::EditRole) final;
+    Qt::ItemFlags flags(const QModelIndex &index) const final;
+    bool insertRows(int row, int count,
+                    const QModelIndex &parent = QModelIndex()) final;
+    bool removeRows(int row, int count,
+                    const QModelIndex &parent = QModelIndex()) final;
+
+    void insertItem(int row, const QString &text, const QIcon &icon);
+    int insertItems(int row, const QByteArray &lines);
+    int findItem(const char *text);
+
+private:
+    struct Item
+    {
+        int offset;  // Text offset in the texts buffer
+        int size;    // Text size in bytes
+        int icon;    // Index in the icons vector or -1 if none
+    };
+
+    void setText(Item &item, const QString &text);
+    void setIcon(Item &item, const QIcon &icon);
+    void compact();
+    void indexItem(int row);
+    void unindexItem(int row);
+
+    QVector<Item> items;
+    QByteArray texts;
+    QVector<QIcon> icons;
+    int wastedTexts;  // Bytes not referred by items
+    int wastedIcons;  // Icons not referred by items
+    QMultiHash<uint, int> textsIndex;  // Rows by hashes of their texts
+    bool indexDirty;  // The index must be rebuilt
+};
+
+class Slider : public QSlider
+{
+    Q_OBJECT
+
+public:
+    Slider();
+
+    void setDebounceInterval(int msec);
+
+signals:
+    void valueReported(int);
+
+private slots:
+    void changeValue(int value);
+    void reportValue();
+
+private:
+    QTimer debounceTimer;
+};
+
+//  Below class decodes a picture on a thread of the pool and delivers it to
+//  the receiver's pictureLoaded slot unless the load is cancelled.
+class PictureLoader : public QRunnable
+{
+public:
+    PictureLoader(QObject *receiver, int id, const QString &file,
+                  const QSize &size, QSharedPointer<QAtomicInt> cancelled);
+
+    void run();
+
+    static QSize fitSize(const QSize &imageSize, const QSize &size);
+
+private:
+    QObject *receiver;
+    int id;
+    QString file;
+    QSize size;
+    QSharedPointer<QAtomicInt> cancelled;
+};
+
+//  Below class reads a text file on a thread of the pool and delivers it to
+//  the receiver's textLoaded slot by chunks. It waits for the receiver to
+//  append the chunks delivered before so the file isn't read into memory
+//  faster than it is displayed.
+class TextLoader : public QRunnable
+{
+public:
+    TextLoader(QObject *receiver, int id, const QString &file,
+               QSharedPointer<QAtomicInt> cancelled,
+               QSharedPointer<QSemaphore> chunks);
+
+    void run();
+
+private:
+    QObject *receiver;
+    int id;
+    QString file;
+    QSharedPointer<QAtomicInt> cancelled;
+    QSharedPointer<QSemaphore> chunks;
+};
 
 #endif  // DIALOGBOX_H_